@@ -23,11 +23,15 @@ deca_proto_compile = rule(
     toolchains = [str(Label("@rules_proto_grpc//protoc:toolchain_type"))],
 )
 
-def deca_proto_library(name, protos, deps = []):
+# `options` are passed to the code generator, e.g. ["decoder=table"]
+def deca_proto_library(name, protos, deps = [], options = []):
     compiled_name = name + "_comp"
     deca_proto_compile(
         name = compiled_name,
         protos = protos,
+        options = {
+            str(Label("//codegen:decaproto_plugin")): options,
+        },
     )
 
     cc_library(
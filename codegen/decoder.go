@@ -0,0 +1,369 @@
+package main
+
+import (
+	"fmt"
+	"os"
+	"sort"
+	"strconv"
+
+	descriptor "github.com/golang/protobuf/protoc-gen-go/descriptor"
+)
+
+// Emits DecodeImpl, which stores fields directly into the holders instead of
+// looking them up in the descriptor and setting them through reflection.
+//
+// Fields are dispatched by their field numbers, and then the whole tag is
+// compared so that a wire type which doesn't match the field type is
+// rejected like the reflection-based decoder does.
+//
+// With the `decoder=table` option, DecodeImpl hands the table emitted by
+// printParseTable to the shared parser in the runtime instead.
+func printDecoder(m *descriptor.DescriptorProto, ctx *Context, msg_printer *MessagePrinter) {
+	// Declaration
+	msg_printer.publics += "    bool DecodeImpl(decaproto::CodedInputStream& stream) override;\n"
+
+	// Definition
+	var src string = ""
+	src += "\n"
+	src += "bool " + msg_printer.full_name + "::DecodeImpl(decaproto::CodedInputStream& stream) {\n"
+	if ctx.options.decoder == "table" {
+		src += "    return decaproto::ParseWithTable(stream, kParseTable, this);\n"
+		src += "}\n"
+		ctx.printer.source_content += src
+		return
+	}
+	src += `		uint32_t tag;
+		while (!stream.ReachedLimit()) {
+			if (!stream.ReadVarint32(tag)) {
+				// The stream ended. It's fine only if the message isn't sized,
+				// otherwise the data is truncated.
+				return stream.BytesUntilLimit() == SIZE_MAX;
+			}
+			switch (tag >> 3) {
+`
+	for _, f := range m.GetField() {
+		type_name_info := getTypeNameInfo(f)
+		args := map[string]string{
+			"name":        f.GetName(),
+			"holder_name": holderName(f),
+			"view_name":   viewHolderName(f),
+			"cc_type":     type_name_info.cc_type,
+			"number":      strconv.Itoa(int(f.GetNumber())),
+			"tag":         strconv.FormatUint(uint64(f.GetNumber())<<3|getWireType(f), 10),
+		}
+		src += print("field_case", `
+			case {{.number}}: {  // {{.name}}
+`, args)
+
+		repeated := f.GetLabel() == descriptor.FieldDescriptorProto_LABEL_REPEATED
+		if repeated && getWireType(f) != wireTypeLen {
+			// Repeated scalar fields may be packed whether or not they are
+			// declared so.
+			args["packed_tag"] = strconv.FormatUint(uint64(f.GetNumber())<<3|wireTypeLen, 10)
+			switch getWireType(f) {
+			case wireTypeVarint:
+				args["zigzag"] = ""
+				if f.GetType() == descriptor.FieldDescriptorProto_TYPE_SINT32 ||
+					f.GetType() == descriptor.FieldDescriptorProto_TYPE_SINT64 {
+					args["zigzag"] = ", true"
+				}
+				args["read_packed"] = print("read_packed_varints",
+					"stream.ReadVarintArray({{.holder_name}}, size{{.zigzag}})", args)
+			default:
+				args["read_packed"] = print("read_packed_fixed",
+					"stream.ReadFixedArray({{.holder_name}}, size)", args)
+			}
+			src += print("packed_dec", `
+				if (tag == {{.packed_tag}}) {
+					uint32_t size;
+					if (!stream.ReadVarint32(size) || !{{.read_packed}}) {
+						return false;
+					}
+					break;
+				}
+`, args)
+		}
+		src += print("tag_check", `
+				if (tag != {{.tag}}) {
+					return false;
+				}
+`, args)
+
+		// Statement which stores `value`
+		store := "{{.holder_name}} = {{.value}};"
+		if repeated {
+			store = "{{.holder_name}}.push_back({{.value}});"
+		}
+		switch f.GetType() {
+		case descriptor.FieldDescriptorProto_TYPE_INT32,
+			descriptor.FieldDescriptorProto_TYPE_INT64,
+			descriptor.FieldDescriptorProto_TYPE_UINT32,
+			descriptor.FieldDescriptorProto_TYPE_UINT64,
+			descriptor.FieldDescriptorProto_TYPE_ENUM:
+			// Negative int32 values are encoded in 10 bytes, so they are
+			// read as 64-bit varints and truncated.
+			args["value"] = print("varint_value", "static_cast<{{.cc_type}}>(value)", args)
+			src += print("varint_dec", `
+				uint64_t value;
+				if (!stream.ReadVarint64(value)) {
+					return false;
+				}
+				`+store+`
+				break;
+			}
+`, args)
+		case descriptor.FieldDescriptorProto_TYPE_BOOL:
+			args["value"] = "value != 0"
+			src += print("bool_dec", `
+				uint64_t value;
+				if (!stream.ReadVarint64(value)) {
+					return false;
+				}
+				`+store+`
+				break;
+			}
+`, args)
+		case descriptor.FieldDescriptorProto_TYPE_SINT32:
+			args["value"] = "value"
+			src += print("sint32_dec", `
+				int32_t value;
+				if (!stream.ReadSignedVarint32(value)) {
+					return false;
+				}
+				`+store+`
+				break;
+			}
+`, args)
+		case descriptor.FieldDescriptorProto_TYPE_SINT64:
+			args["value"] = "value"
+			src += print("sint64_dec", `
+				int64_t value;
+				if (!stream.ReadSignedVarint64(value)) {
+					return false;
+				}
+				`+store+`
+				break;
+			}
+`, args)
+		case descriptor.FieldDescriptorProto_TYPE_FIXED32,
+			descriptor.FieldDescriptorProto_TYPE_SFIXED32:
+			args["value"] = print("fixed32_value", "static_cast<{{.cc_type}}>(value)", args)
+			src += print("fixed32_dec", `
+				uint32_t value;
+				if (!stream.ReadFixedInt32(value)) {
+					return false;
+				}
+				`+store+`
+				break;
+			}
+`, args)
+		case descriptor.FieldDescriptorProto_TYPE_FLOAT:
+			args["value"] = "decaproto::MemcpyCast<uint32_t, float>(value)"
+			src += print("float_dec", `
+				uint32_t value;
+				if (!stream.ReadFixedInt32(value)) {
+					return false;
+				}
+				`+store+`
+				break;
+			}
+`, args)
+		case descriptor.FieldDescriptorProto_TYPE_FIXED64,
+			descriptor.FieldDescriptorProto_TYPE_SFIXED64:
+			args["value"] = print("fixed64_value", "static_cast<{{.cc_type}}>(value)", args)
+			src += print("fixed64_dec", `
+				uint64_t value;
+				if (!stream.ReadFixedInt64(value)) {
+					return false;
+				}
+				`+store+`
+				break;
+			}
+`, args)
+		case descriptor.FieldDescriptorProto_TYPE_DOUBLE:
+			args["value"] = "decaproto::MemcpyCast<uint64_t, double>(value)"
+			src += print("double_dec", `
+				uint64_t value;
+				if (!stream.ReadFixedInt64(value)) {
+					return false;
+				}
+				`+store+`
+				break;
+			}
+`, args)
+		case descriptor.FieldDescriptorProto_TYPE_STRING:
+			if repeated {
+				src += print("rep_str_dec", `
+				uint32_t size;
+				if (!stream.ReadVarint32(size)) {
+					return false;
+				}
+				{{.holder_name}}.emplace_back();
+				if (!stream.ReadString({{.holder_name}}.back(), size)) {
+					return false;
+				}
+				break;
+			}
+`, args)
+			} else {
+				src += print("str_dec", `
+				uint32_t size;
+				if (!stream.ReadVarint32(size)) {
+					return false;
+				}
+				std::string_view view;
+				if (stream.AliasingEnabled() && stream.ReadStringView(view, size)) {
+					set_{{.name}}_alias(view);
+					break;
+				}
+				{{.view_name}} = std::string_view();
+				if (!stream.ReadString({{.holder_name}}, size)) {
+					return false;
+				}
+				break;
+			}
+`, args)
+			}
+		case descriptor.FieldDescriptorProto_TYPE_MESSAGE:
+			if repeated {
+				args["sub_msg"] = "add_" + f.GetName() + "()"
+			} else {
+				args["sub_msg"] = "mutable_" + f.GetName() + "()"
+			}
+			src += print("msg_dec", `
+				uint32_t size;
+				if (!stream.ReadVarint32(size)) {
+					return false;
+				}
+				if (!decaproto::DecodeMessage(stream, size, {{.sub_msg}})) {
+					return false;
+				}
+				break;
+			}
+`, args)
+		default:
+			fmt.Fprintf(os.Stderr, "%s %s field is not supported yet\n", f.GetTypeName(), f.GetName())
+			os.Exit(1)
+		}
+	}
+	src += `
+			default:
+				// TODO: Keep unknown fields so that they survive re-encoding.
+				if (!decaproto::SkipUnknownField(
+						stream, static_cast<decaproto::WireType>(tag & 7))) {
+					return false;
+				}
+				break;
+			}
+		}
+		return true;
+`
+	src += "}\n"
+	ctx.printer.source_content += src
+}
+
+// Name of the static member function which returns the object to decode
+// field `f` into.
+func mutableFieldFuncName(f *descriptor.FieldDescriptorProto) string {
+	return f.GetName() + "__Mutable"
+}
+
+// Emits kParseTable, which describes the layout of the fields for
+// decaproto::ParseWithTable().
+//
+// The table refers to private holders, so it's a static member of the
+// message. It's emitted whatever the decoder option is, since tables of
+// other messages refer to it.
+func printParseTable(m *descriptor.DescriptorProto, ctx *Context, msg_printer *MessagePrinter) {
+	full_name := msg_printer.full_name
+
+	// Declaration
+	msg_printer.publics += "    static const decaproto::ParseTable kParseTable;\n"
+
+	fields := make([]*descriptor.FieldDescriptorProto, len(m.GetField()))
+	copy(fields, m.GetField())
+	sort.Slice(fields, func(i, j int) bool {
+		return fields[i].GetNumber() < fields[j].GetNumber()
+	})
+
+	// Definition
+	var src string = ""
+	src += "\n"
+	// Generated messages aren't standard-layout because of the vtable, but
+	// offsetof works on them with GCC and Clang.
+	src += "#pragma GCC diagnostic push\n"
+	src += "#pragma GCC diagnostic ignored \"-Winvalid-offsetof\"\n"
+
+	var entries string = ""
+	for _, f := range fields {
+		repeated := f.GetLabel() == descriptor.FieldDescriptorProto_LABEL_REPEATED
+		args := map[string]string{
+			"msg_full_name":  full_name,
+			"name":           f.GetName(),
+			"number":         strconv.Itoa(int(f.GetNumber())),
+			"wire_type":      wireTypeEnumName(f),
+			"deca_enum_name": getTypeNameInfo(f).deca_enum_name,
+			"repeated":       strconv.FormatBool(repeated),
+			"offset":         "offsetof(" + full_name + ", " + holderName(f) + ")",
+			"view_offset":    "0",
+			"mutable_field":  "nullptr",
+			"sub_table":      "nullptr",
+			"mutable_func":   mutableFieldFuncName(f),
+		}
+
+		switch f.GetType() {
+		case descriptor.FieldDescriptorProto_TYPE_STRING:
+			if !repeated {
+				args["view_offset"] = "offsetof(" + full_name + ", " + viewHolderName(f) + ")"
+			}
+		case descriptor.FieldDescriptorProto_TYPE_MESSAGE:
+			args["sub_table"] = "&" + getTypeNameInfo(f).cc_type + "::kParseTable"
+			fallthrough
+		case descriptor.FieldDescriptorProto_TYPE_ENUM:
+			if f.GetType() == descriptor.FieldDescriptorProto_TYPE_ENUM && !repeated {
+				break
+			}
+			accessor := "mutable_" + f.GetName()
+			if repeated {
+				accessor = "add_" + f.GetName()
+			}
+			args["accessor"] = accessor
+			args["mutable_field"] = "&" + full_name + "::" + mutableFieldFuncName(f)
+			msg_printer.PushPrivate(
+				print("mutable_field_decl",
+					"    static void* {{.mutable_func}}(void* message);\n",
+					args))
+			src += print("mutable_field_def", `
+void* {{.msg_full_name}}::{{.mutable_func}}(void* message) {
+    return static_cast<{{.msg_full_name}}*>(message)->{{.accessor}}();
+}
+`, args)
+		}
+
+		entries += print("parse_table_entry", `
+    {
+        {{.number}},  // {{.name}}
+        {{.wire_type}},
+        {{.deca_enum_name}},
+        {{.repeated}},
+        {{.offset}},
+        {{.view_offset}},
+        {{.mutable_field}},
+        {{.sub_table}},
+    },`, args)
+	}
+
+	if len(fields) == 0 {
+		src += "\n"
+		src += "const decaproto::ParseTable " + full_name + "::kParseTable = {nullptr, 0};\n"
+	} else {
+		msg_printer.PushPrivate("    static const decaproto::TableField kParseFields[];\n")
+		src += "\n"
+		src += "const decaproto::TableField " + full_name + "::kParseFields[] = {" + entries + "\n};\n"
+		src += "\n"
+		src += "const decaproto::ParseTable " + full_name + "::kParseTable = {\n"
+		src += "    kParseFields, " + strconv.Itoa(len(fields)) + "};\n"
+	}
+	src += "#pragma GCC diagnostic pop\n"
+	ctx.printer.source_content += src
+}
@@ -6,7 +6,7 @@ import (
 	descriptor "github.com/golang/protobuf/protoc-gen-go/descriptor"
 )
 
-func printDescriptor(m *descriptor.DescriptorProto, fp *FilePrinter, mp *MessagePrinter) {
+func printDescriptor(m *descriptor.DescriptorProto, ctx *Context, mp *MessagePrinter) {
 	// Declaration
 	mp.publics += "    const decaproto::Descriptor* GetDescriptor() const override;\n"
 
@@ -26,7 +26,12 @@ func printDescriptor(m *descriptor.DescriptorProto, fp *FilePrinter, mp *Message
 		tag := f.GetNumber()
 		field_type := getTypeNameInfo(f).deca_enum_name
 		src += "    "
-		if f.GetLabel() == descriptor.FieldDescriptorProto_LABEL_REPEATED {
+		if isPacked(f, ctx) {
+			src += fmt.Sprintf("%s->RegisterField(decaproto::FieldDescriptor(%d, %s, true, true));\n",
+				desc_name,
+				tag,
+				field_type)
+		} else if f.GetLabel() == descriptor.FieldDescriptorProto_LABEL_REPEATED {
 			src += fmt.Sprintf("%s->RegisterField(decaproto::FieldDescriptor(%d, %s, true));\n",
 				desc_name,
 				tag,
@@ -41,5 +46,5 @@ func printDescriptor(m *descriptor.DescriptorProto, fp *FilePrinter, mp *Message
 	src += "    return " + desc_name + ";\n"
 	src += "}\n"
 
-	fp.source_content += src
+	ctx.printer.source_content += src
 }
@@ -3,10 +3,164 @@ package main
 import (
 	"fmt"
 	"os"
+	"strings"
 
 	descriptor "github.com/golang/protobuf/protoc-gen-go/descriptor"
 )
 
+// Wire types in the encoding of tags
+const (
+	wireTypeVarint = 0
+	wireTypeI64    = 1
+	wireTypeLen    = 2
+	wireTypeI32    = 5
+)
+
+func getWireType(f *descriptor.FieldDescriptorProto) uint64 {
+	switch f.GetType() {
+	case descriptor.FieldDescriptorProto_TYPE_FIXED64,
+		descriptor.FieldDescriptorProto_TYPE_SFIXED64,
+		descriptor.FieldDescriptorProto_TYPE_DOUBLE:
+		return wireTypeI64
+	case descriptor.FieldDescriptorProto_TYPE_FIXED32,
+		descriptor.FieldDescriptorProto_TYPE_SFIXED32,
+		descriptor.FieldDescriptorProto_TYPE_FLOAT:
+		return wireTypeI32
+	case descriptor.FieldDescriptorProto_TYPE_STRING,
+		descriptor.FieldDescriptorProto_TYPE_BYTES,
+		descriptor.FieldDescriptorProto_TYPE_MESSAGE:
+		return wireTypeLen
+	}
+	return wireTypeVarint
+}
+
+// Name of decaproto::WireType for the wire type of `f`.
+func wireTypeEnumName(f *descriptor.FieldDescriptorProto) string {
+	switch getWireType(f) {
+	case wireTypeI64:
+		return "decaproto::kI64"
+	case wireTypeLen:
+		return "decaproto::kLen"
+	case wireTypeI32:
+		return "decaproto::kI32"
+	}
+	return "decaproto::kVarint"
+}
+
+// Whether repeated field `f` is encoded packed, i.e. as one LEN record which
+// holds all the values. Scalar fields are packed by default in proto3, and
+// `[packed = ...]` overrides it.
+func isPacked(f *descriptor.FieldDescriptorProto, ctx *Context) bool {
+	if f.GetLabel() != descriptor.FieldDescriptorProto_LABEL_REPEATED ||
+		getWireType(f) == wireTypeLen {
+		return false
+	}
+	if f.GetOptions() != nil && f.GetOptions().Packed != nil {
+		return f.GetOptions().GetPacked()
+	}
+	return ctx.proto3
+}
+
+// Returns the varint encoding of the tag of `f` as it's written by
+// EncodeImpl.
+func encodeTag(f *descriptor.FieldDescriptorProto, ctx *Context) []byte {
+	wire_type := getWireType(f)
+	if isPacked(f, ctx) {
+		wire_type = wireTypeLen
+	}
+	tag := uint64(f.GetNumber())<<3 | wire_type
+	var bytes []byte
+	for tag >= 0x80 {
+		bytes = append(bytes, byte(tag)|0x80)
+		tag >>= 7
+	}
+	return append(bytes, byte(tag))
+}
+
+// Name of the constant which holds the encoded tag of `f`.
+func tagConstName(msg_printer *MessagePrinter, f *descriptor.FieldDescriptorProto) string {
+	return "k" + msg_printer.full_name + "__" + f.GetName() + "__Tag"
+}
+
+// Emits the tags of the fields encoded in advance, so that EncodeImpl writes
+// them with a fixed-length copy and ComputeEncodedSize adds their sizes as
+// constants.
+func printTagConstants(m *descriptor.DescriptorProto, ctx *Context, msg_printer *MessagePrinter) {
+	if len(m.GetField()) == 0 {
+		return
+	}
+	var src string = ""
+	src += "\n"
+	src += "// Encoded tags of " + msg_printer.full_name + "\n"
+	for _, f := range m.GetField() {
+		var bytes []string
+		for _, b := range encodeTag(f, ctx) {
+			bytes = append(bytes, fmt.Sprintf("0x%02x", b))
+		}
+		src += "constexpr uint8_t " + tagConstName(msg_printer, f) + "[] = {" +
+			strings.Join(bytes, ", ") + "};\n"
+	}
+	ctx.printer.source_content += src
+}
+
+// Returns statements which compute `packed_size`, the size of the values of
+// packed field `f` without the tag and the length.
+func printPackedSize(f *descriptor.FieldDescriptorProto, args map[string]string) string {
+	switch f.GetType() {
+	case descriptor.FieldDescriptorProto_TYPE_FIXED32,
+		descriptor.FieldDescriptorProto_TYPE_SFIXED32,
+		descriptor.FieldDescriptorProto_TYPE_FLOAT:
+		return print("packed_fixed32_size", `
+			size_t packed_size = 4 * {{.holder_name}}.size();`, args)
+	case descriptor.FieldDescriptorProto_TYPE_FIXED64,
+		descriptor.FieldDescriptorProto_TYPE_SFIXED64,
+		descriptor.FieldDescriptorProto_TYPE_DOUBLE:
+		return print("packed_fixed64_size", `
+			size_t packed_size = 8 * {{.holder_name}}.size();`, args)
+	case descriptor.FieldDescriptorProto_TYPE_SINT32,
+		descriptor.FieldDescriptorProto_TYPE_SINT64:
+		return print("packed_sint_size", `
+			size_t packed_size = 0;
+			for (auto item : {{.holder_name}}) {
+				packed_size += decaproto::ComputeEncodedVarintSize(
+						decaproto::CodedOutputStream::EncodeZigZag(item));
+			}`, args)
+	}
+	// Negative int32 and enum values are sign-extended to 10 bytes.
+	return print("packed_varint_size", `
+			size_t packed_size = 0;
+			for (auto item : {{.holder_name}}) {
+				packed_size += decaproto::ComputeEncodedVarintSize(item);
+			}`, args)
+}
+
+// Emits the encoder of packed field `f`: the tag, the length and the values
+// without their tags. Fixed-width values are copied at once.
+func printPackedEncoder(f *descriptor.FieldDescriptorProto, args map[string]string) string {
+	var values string
+	switch getWireType(f) {
+	case wireTypeI32, wireTypeI64:
+		values = `
+			stream.WriteFixedArray({{.holder_name}});`
+	default:
+		write := "WriteVarint64"
+		if f.GetType() == descriptor.FieldDescriptorProto_TYPE_SINT32 ||
+			f.GetType() == descriptor.FieldDescriptorProto_TYPE_SINT64 {
+			write = "WriteSignedVarint64"
+		}
+		values = `
+			for (auto item : {{.holder_name}}) {
+				stream.` + write + `(item);
+			}`
+	}
+	return print("packed_enc", `
+		if (!{{.holder_name}}.empty()) {`+printPackedSize(f, args)+`
+			stream.WriteRawTag({{.tag}});
+			stream.WriteVarint64(packed_size);`+values+`
+		}
+		`, args)
+}
+
 func printEncoder(m *descriptor.DescriptorProto, ctx *Context, msg_printer *MessagePrinter) {
 	// Declaration
 	msg_printer.publics += "    bool EncodeImpl(decaproto::CodedOutputStream& stream) const override;\n"
@@ -19,28 +173,26 @@ func printEncoder(m *descriptor.DescriptorProto, ctx *Context, msg_printer *Mess
 		type_name_info := getTypeNameInfo(f)
 		args := map[string]string{
 			"name":        f.GetName(),
-			"field_num":   fmt.Sprintf("%d", f.GetNumber()),
 			"holder_name": holderName(f),
 			"cc_type":     type_name_info.cc_type,
+			"tag":         tagConstName(msg_printer, f),
 		}
-		if f.GetLabel() == descriptor.FieldDescriptorProto_LABEL_REPEATED {
+		if isPacked(f, ctx) {
+			src += printPackedEncoder(f, args)
+		} else if f.GetLabel() == descriptor.FieldDescriptorProto_LABEL_REPEATED {
 			// Non-repeated field
 			switch f.GetType() {
+			// Negative int32 and enum values are sign-extended to 64 bits, so
+			// they are written with WriteVarint64 too.
 			case descriptor.FieldDescriptorProto_TYPE_INT32,
 				descriptor.FieldDescriptorProto_TYPE_UINT32,
 				descriptor.FieldDescriptorProto_TYPE_ENUM,
-				descriptor.FieldDescriptorProto_TYPE_BOOL:
-				src += print("rep_varint32_enc", `
-					for (auto item : {{.holder_name}}) {
-						stream.WriteTag({{.field_num}}, decaproto::WireType::kVarint);
-						stream.WriteVarint32(item);
-					}
-					`, args)
-			case descriptor.FieldDescriptorProto_TYPE_INT64,
+				descriptor.FieldDescriptorProto_TYPE_BOOL,
+				descriptor.FieldDescriptorProto_TYPE_INT64,
 				descriptor.FieldDescriptorProto_TYPE_UINT64:
-				src += print("rep_varint64_enc", `
+				src += print("rep_varint_enc", `
 					for (auto item : {{.holder_name}}) {
-						stream.WriteTag({{.field_num}}, decaproto::WireType::kVarint);
+						stream.WriteRawTag({{.tag}});
 						stream.WriteVarint64(item);
 					}
 					`, args)
@@ -48,14 +200,14 @@ func printEncoder(m *descriptor.DescriptorProto, ctx *Context, msg_printer *Mess
 				descriptor.FieldDescriptorProto_TYPE_SFIXED32:
 				src += print("rep_fixed32_enc", `
 					for (auto item : {{.holder_name}}) {
-						stream.WriteTag({{.field_num}}, decaproto::WireType::kI32);
+						stream.WriteRawTag({{.tag}});
 						stream.WriteFixedInt32(item);
 					}
 					`, args)
 			case descriptor.FieldDescriptorProto_TYPE_FLOAT:
 				src += print("rep_float_enc", `
 					for (float item : {{.holder_name}}) {
-						stream.WriteTag({{.field_num}}, decaproto::WireType::kI32);
+						stream.WriteRawTag({{.tag}});
 						stream.WriteFixedInt32(decaproto::MemcpyCast<float, uint32_t>(item));
 					}
 					`, args)
@@ -63,7 +215,7 @@ func printEncoder(m *descriptor.DescriptorProto, ctx *Context, msg_printer *Mess
 				descriptor.FieldDescriptorProto_TYPE_SFIXED64:
 				src += print("rep_float_enc", `
 					for (auto item : {{.holder_name}}) {
-						stream.WriteTag({{.field_num}}, decaproto::WireType::kI64);
+						stream.WriteRawTag({{.tag}});
 						stream.WriteFixedInt64(item);
 					}
 					`, args)
@@ -71,28 +223,28 @@ func printEncoder(m *descriptor.DescriptorProto, ctx *Context, msg_printer *Mess
 			case descriptor.FieldDescriptorProto_TYPE_DOUBLE:
 				src += print("rep_double_enc", `
 					for (double item : {{.holder_name}}) {
-						stream.WriteTag({{.field_num}}, decaproto::WireType::kI64);
+						stream.WriteRawTag({{.tag}});
 						stream.WriteFixedInt64(decaproto::MemcpyCast<double, uint64_t>(item));
 					}
 					`, args)
 			case descriptor.FieldDescriptorProto_TYPE_SINT32:
 				src += print("rep_sint32_enc", `
 					for (auto item : {{.holder_name}}) {
-						stream.WriteTag({{.field_num}}, decaproto::WireType::kVarint);
+						stream.WriteRawTag({{.tag}});
 						stream.WriteSignedVarint32(item);
 					}
 					`, args)
 			case descriptor.FieldDescriptorProto_TYPE_SINT64:
 				src += print("rep_sint64_enc", `
 					for (auto item : {{.holder_name}}) {
-						stream.WriteTag({{.field_num}}, decaproto::WireType::kVarint);
+						stream.WriteRawTag({{.tag}});
 						stream.WriteSignedVarint64(item);
 					}
 					`, args)
 			case descriptor.FieldDescriptorProto_TYPE_STRING:
 				src += print("rep_str_enc", `
 					for (auto& item : {{.holder_name}}) {
-						stream.WriteTag({{.field_num}}, decaproto::WireType::kLen);
+						stream.WriteRawTag({{.tag}});
 						stream.WriteVarint32(item.size());
 						stream.WriteString(item);
 					}
@@ -101,7 +253,7 @@ func printEncoder(m *descriptor.DescriptorProto, ctx *Context, msg_printer *Mess
 				src += print("rep_sub_msg_enc", `
 					for (auto& item : {{.holder_name}}) {
 						size_t sub_msg_size = item.ComputeEncodedSize();
-						stream.WriteTag({{.field_num}}, decaproto::WireType::kLen);
+						stream.WriteRawTag({{.tag}});
 						stream.WriteVarint32(sub_msg_size);
 						item.EncodeImpl(stream);
 					}
@@ -112,21 +264,17 @@ func printEncoder(m *descriptor.DescriptorProto, ctx *Context, msg_printer *Mess
 			}
 		} else {
 			switch f.GetType() {
+			// Negative int32 and enum values are sign-extended to 64 bits, so
+			// they are written with WriteVarint64 too.
 			case descriptor.FieldDescriptorProto_TYPE_INT32,
 				descriptor.FieldDescriptorProto_TYPE_UINT32,
 				descriptor.FieldDescriptorProto_TYPE_ENUM,
-				descriptor.FieldDescriptorProto_TYPE_BOOL:
-				src += print("varint32_enc", `
-					if ({{.holder_name}} != {{.cc_type}}()) {
-						stream.WriteTag({{.field_num}}, decaproto::WireType::kVarint);
-						stream.WriteVarint32({{.holder_name}});
-					}
-					`, args)
-			case descriptor.FieldDescriptorProto_TYPE_INT64,
+				descriptor.FieldDescriptorProto_TYPE_BOOL,
+				descriptor.FieldDescriptorProto_TYPE_INT64,
 				descriptor.FieldDescriptorProto_TYPE_UINT64:
-				src += print("varint64_enc", `
+				src += print("varint_enc", `
 					if ({{.holder_name}} != {{.cc_type}}()) {
-						stream.WriteTag({{.field_num}}, decaproto::WireType::kVarint);
+						stream.WriteRawTag({{.tag}});
 						stream.WriteVarint64({{.holder_name}});
 					}
 					`, args)
@@ -134,14 +282,14 @@ func printEncoder(m *descriptor.DescriptorProto, ctx *Context, msg_printer *Mess
 				descriptor.FieldDescriptorProto_TYPE_SFIXED32:
 				src += print("fixed32_enc", `
 					if ({{.holder_name}} != {{.cc_type}}()) {
-						stream.WriteTag({{.field_num}}, decaproto::WireType::kI32);
+						stream.WriteRawTag({{.tag}});
 						stream.WriteFixedInt32({{.holder_name}});
 					}
 					`, args)
 			case descriptor.FieldDescriptorProto_TYPE_FLOAT:
 				src += print("float_enc", `
 					if ({{.holder_name}} != {{.cc_type}}()) {
-						stream.WriteTag({{.field_num}}, decaproto::WireType::kI32);
+						stream.WriteRawTag({{.tag}});
 						stream.WriteFixedInt32(decaproto::MemcpyCast<float, uint32_t>({{.holder_name}}));
 					}
 					`, args)
@@ -149,7 +297,7 @@ func printEncoder(m *descriptor.DescriptorProto, ctx *Context, msg_printer *Mess
 				descriptor.FieldDescriptorProto_TYPE_SFIXED64:
 				src += print("float_enc", `
 					if ({{.holder_name}} != {{.cc_type}}()) {
-						stream.WriteTag({{.field_num}}, decaproto::WireType::kI64);
+						stream.WriteRawTag({{.tag}});
 						stream.WriteFixedInt64({{.holder_name}});
 					}
 					`, args)
@@ -157,37 +305,38 @@ func printEncoder(m *descriptor.DescriptorProto, ctx *Context, msg_printer *Mess
 			case descriptor.FieldDescriptorProto_TYPE_DOUBLE:
 				src += print("double_enc", `
 					if ({{.holder_name}} != {{.cc_type}}()) {
-						stream.WriteTag({{.field_num}}, decaproto::WireType::kI64);
+						stream.WriteRawTag({{.tag}});
 						stream.WriteFixedInt64(decaproto::MemcpyCast<double, uint64_t>({{.holder_name}}));
 					}
 					`, args)
 			case descriptor.FieldDescriptorProto_TYPE_SINT32:
 				src += print("sint32_enc", `
 					if ({{.holder_name}} != {{.cc_type}}()) {
-						stream.WriteTag({{.field_num}}, decaproto::WireType::kVarint);
+						stream.WriteRawTag({{.tag}});
 						stream.WriteSignedVarint32({{.holder_name}});
 					}
 					`, args)
 			case descriptor.FieldDescriptorProto_TYPE_SINT64:
 				src += print("sint64_enc", `
 					if ({{.holder_name}} != {{.cc_type}}()) {
-						stream.WriteTag({{.field_num}}, decaproto::WireType::kVarint);
+						stream.WriteRawTag({{.tag}});
 						stream.WriteSignedVarint64({{.holder_name}});
 					}
 					`, args)
 			case descriptor.FieldDescriptorProto_TYPE_STRING:
 				src += print("str_enc", `
-					if (!{{.holder_name}}.empty()) {
-						stream.WriteTag({{.field_num}}, decaproto::WireType::kLen);
-						stream.WriteVarint32({{.holder_name}}.size());
-						stream.WriteString({{.holder_name}});
+					if (!{{.name}}_view().empty()) {
+						std::string_view value = {{.name}}_view();
+						stream.WriteRawTag({{.tag}});
+						stream.WriteVarint32(value.size());
+						stream.WriteString(value);
 					}
 					`, args)
 			case descriptor.FieldDescriptorProto_TYPE_MESSAGE:
 				src += print("rep_str_enc", `
 					if (has_{{.name}}()) {
 						size_t sub_msg_size = {{.holder_name}}->ComputeEncodedSize();
-						stream.WriteTag({{.field_num}}, decaproto::WireType::kLen);
+						stream.WriteRawTag({{.tag}});
 						stream.WriteVarint32(sub_msg_size);
 						{{.holder_name}}->EncodeImpl(stream);
 					}
@@ -198,7 +347,9 @@ func printEncoder(m *descriptor.DescriptorProto, ctx *Context, msg_printer *Mess
 			}
 		}
 	}
-	src += "		return true;\n"
+	// Writes above don't check their results. A failure is latched by the
+	// stream and reported once here.
+	src += "		return !stream.HadError();\n"
 	src += "}\n"
 	ctx.printer.source_content += src
 }
@@ -217,8 +368,17 @@ func printComputeEncodedSize(m *descriptor.DescriptorProto, ctx *Context, msg_pr
 			"name":        f.GetName(),
 			"holder_name": holderName(f),
 			"cc_type":     getTypeNameInfo(f).cc_type,
+			"tag":         tagConstName(msg_printer, f),
 		}
-		if f.GetLabel() == descriptor.FieldDescriptorProto_LABEL_REPEATED {
+		if isPacked(f, ctx) {
+			src += print("packed_size", `
+		if (!{{.holder_name}}.empty()) {`+printPackedSize(f, args)+`
+			size += sizeof({{.tag}});  // tag
+			size += decaproto::ComputeEncodedVarintSize(packed_size);
+			size += packed_size;
+		}
+		`, args)
+		} else if f.GetLabel() == descriptor.FieldDescriptorProto_LABEL_REPEATED {
 			// Non-repeated field
 			switch f.GetType() {
 			case descriptor.FieldDescriptorProto_TYPE_INT32,
@@ -229,7 +389,7 @@ func printComputeEncodedSize(m *descriptor.DescriptorProto, ctx *Context, msg_pr
 				descriptor.FieldDescriptorProto_TYPE_BOOL:
 				src += print("rep_varint_size", `
 		for (auto& item : {{.holder_name}}) {
-			size += 1;  // tag
+			size += sizeof({{.tag}});  // tag
 			size += decaproto::ComputeEncodedVarintSize(item);
 		}
 		`, args)
@@ -237,20 +397,20 @@ func printComputeEncodedSize(m *descriptor.DescriptorProto, ctx *Context, msg_pr
 				descriptor.FieldDescriptorProto_TYPE_SFIXED32,
 				descriptor.FieldDescriptorProto_TYPE_FLOAT:
 				src += print("rep_fixed32_size", `
-		size += (1 + 4) * {{.holder_name}}.size();
+		size += (sizeof({{.tag}}) + 4) * {{.holder_name}}.size();
 					`, args)
 			case descriptor.FieldDescriptorProto_TYPE_FIXED64,
 				descriptor.FieldDescriptorProto_TYPE_SFIXED64,
 				descriptor.FieldDescriptorProto_TYPE_DOUBLE:
 				src += print("rep_fixed32_size", `
-	    size += (1 + 8) * {{.holder_name}}.size();
+	    size += (sizeof({{.tag}}) + 8) * {{.holder_name}}.size();
 					`, args)
-			case descriptor.FieldDescriptorProto_TYPE_SINT32:
-			case descriptor.FieldDescriptorProto_TYPE_SINT64:
+			case descriptor.FieldDescriptorProto_TYPE_SINT32,
+				descriptor.FieldDescriptorProto_TYPE_SINT64:
 				src += print("sint_size", `
 		for (auto item : {{.holder_name}}) {
 			int64_t zigzag = decaproto::CodedOutputStream::EncodeZigZag(item);
-			size += 1;  // tag
+			size += sizeof({{.tag}});  // tag
 			size += decaproto::ComputeEncodedVarintSize(zigzag);
 		}
 		`, args)
@@ -259,7 +419,7 @@ func printComputeEncodedSize(m *descriptor.DescriptorProto, ctx *Context, msg_pr
 				src += print("rep_fixed64_size", `
 		for (auto& item : {{.holder_name}}) {
 			// tag
-			size += 1;
+			size += sizeof({{.tag}});
 			// LEN
 			size += decaproto::ComputeEncodedVarintSize(item.size());
 			// value
@@ -271,7 +431,7 @@ func printComputeEncodedSize(m *descriptor.DescriptorProto, ctx *Context, msg_pr
 		for (auto& item : {{.holder_name}}) {
 			size_t sub_msg_size = item.ComputeEncodedSize();
 			// tag
-			size += 1;
+			size += sizeof({{.tag}});
 			// LEN
 			size += decaproto::ComputeEncodedVarintSize(sub_msg_size);
 			// value
@@ -293,7 +453,7 @@ func printComputeEncodedSize(m *descriptor.DescriptorProto, ctx *Context, msg_pr
 				descriptor.FieldDescriptorProto_TYPE_BOOL:
 				src += print("varint_size", `
 		if ( {{.holder_name}} != {{.cc_type}}() ) {
-			size += 1;  // tag
+			size += sizeof({{.tag}});  // tag
 			size += decaproto::ComputeEncodedVarintSize({{.holder_name}});
 		}
 		`, args)
@@ -302,7 +462,7 @@ func printComputeEncodedSize(m *descriptor.DescriptorProto, ctx *Context, msg_pr
 				descriptor.FieldDescriptorProto_TYPE_FLOAT:
 				src += print("fixed32_size", `
 		if ( {{.holder_name}} != {{.cc_type}}() ) {
-			size += 1;  // tag
+			size += sizeof({{.tag}});  // tag
 			size += 4;
 		}
 		`, args)
@@ -311,28 +471,28 @@ func printComputeEncodedSize(m *descriptor.DescriptorProto, ctx *Context, msg_pr
 				descriptor.FieldDescriptorProto_TYPE_DOUBLE:
 				src += print("fixed64_size", `
 		if ( {{.holder_name}} != {{.cc_type}}() ) {
-			size += 1;  // tag
+			size += sizeof({{.tag}});  // tag
 			size += 8;
 		}
 		`, args)
-			case descriptor.FieldDescriptorProto_TYPE_SINT32:
-			case descriptor.FieldDescriptorProto_TYPE_SINT64:
+			case descriptor.FieldDescriptorProto_TYPE_SINT32,
+				descriptor.FieldDescriptorProto_TYPE_SINT64:
 				src += print("sint_size", `
 		if ( {{.holder_name}} != {{.cc_type}}() ) {
 			int64_t zigzag = decaproto::CodedOutputStream::EncodeZigZag({{.holder_name}});
-			size += 1;  // tag
+			size += sizeof({{.tag}});  // tag
 			size += decaproto::ComputeEncodedVarintSize(zigzag);
 		}
 `, args)
 			case descriptor.FieldDescriptorProto_TYPE_STRING:
 				src += print("str_size", `
-		if ( !{{.holder_name}}.empty() ) {
+		if ( !{{.name}}_view().empty() ) {
 			// tag
-			size += 1;
+			size += sizeof({{.tag}});
 			// LEN
-			size += decaproto::ComputeEncodedVarintSize({{.holder_name}}.size());
+			size += decaproto::ComputeEncodedVarintSize({{.name}}_view().size());
 			// value
-			size += {{.holder_name}}.size();
+			size += {{.name}}_view().size();
 		}
 		`, args)
 			case descriptor.FieldDescriptorProto_TYPE_MESSAGE:
@@ -340,7 +500,7 @@ func printComputeEncodedSize(m *descriptor.DescriptorProto, ctx *Context, msg_pr
 		if ( has_{{.name}}() ) {
 			size_t sub_msg_size = {{.holder_name}}->ComputeEncodedSize();
 			// tag
-			size += 1;
+			size += sizeof({{.tag}});
 			// LEN
 			size += decaproto::ComputeEncodedVarintSize(sub_msg_size);
 			// value
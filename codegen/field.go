@@ -189,6 +189,11 @@ func holderName(f *descriptor.FieldDescriptorProto) string {
 	return f.GetName() + "__"
 }
 
+// Holds the view of a string field which refers to the input buffer.
+func viewHolderName(f *descriptor.FieldDescriptorProto) string {
+	return f.GetName() + "__view"
+}
+
 func addPrimitiveField(f *descriptor.FieldDescriptorProto, type_name_info *TypeNameInfo, msg_printer *MessagePrinter) {
 	args := map[string]string{
 		"cc_type":     type_name_info.cc_type,
@@ -224,31 +229,66 @@ func addStringField(f *descriptor.FieldDescriptorProto, type_name_info *TypeName
 	args := map[string]string{
 		"cc_type":     type_name_info.cc_type,
 		"holder_name": holderName(f),
+		"view_name":   viewHolderName(f),
 		"f_name":      f.GetName(),
 	}
 	msg_printer.PushInitializer(
 		print("init_default_values", "{{.holder_name}}({{.cc_type}}())", args))
+	msg_printer.PushInitializer(
+		print("init_default_view_values", "{{.view_name}}()", args))
 
+	// The field refers to the input buffer instead of the holder while the
+	// view has non-null data (see set_xxx_alias()).
 	msg_printer.PushPrivate(
-		print("pri_str", "    {{.cc_type}} {{.holder_name}};\n", args))
+		print("pri_str",
+			"    {{.cc_type}} {{.holder_name}};\n"+
+				"    std::string_view {{.view_name}};\n",
+			args))
 
 	msg_printer.PushPublic(
 		print("pub_str", `
+	// Must not be called while {{.f_name}} refers to the input buffer (see
+	// set_{{.f_name}}_alias()). Read such messages with {{.f_name}}_view(), or
+	// take a copy with mutable_{{.f_name}}().
 	inline const {{.cc_type}}& {{.f_name}}() const {
+	    assert({{.view_name}}.data() == nullptr &&
+	           "{{.f_name}} is aliased. Use {{.f_name}}_view() instead.");
+	    return {{.holder_name}};
+	}
+
+	// Returns {{.f_name}} without copying it even if it refers to the
+	// input buffer.
+	inline std::string_view {{.f_name}}_view() const {
+	    if ({{.view_name}}.data() != nullptr) {
+	        return {{.view_name}};
+	    }
 	    return {{.holder_name}};
 	}
 
-	// TODO: Support string_view
 	inline void set_{{.f_name}}(const {{.cc_type}}& value) {
 	    {{.holder_name}} = value;
+	    {{.view_name}} = std::string_view();
+	}
+
+	// Makes {{.f_name}} refer to the bytes of value without copying them.
+	// They must outlive this message or the next change of {{.f_name}}.
+	inline void set_{{.f_name}}_alias(std::string_view value) {
+	    {{.holder_name}}.clear();
+	    {{.view_name}} = value;
 	}
 
 	inline std::string* mutable_{{.f_name}}() {
+	    if ({{.view_name}}.data() != nullptr) {
+	        // Copy the aliased bytes so that they can be modified.
+	        {{.holder_name}}.assign({{.view_name}}.data(), {{.view_name}}.size());
+	        {{.view_name}} = std::string_view();
+	    }
 	    return &{{.holder_name}};
 	}
 
 	inline void clear_{{.f_name}}() {
 	    {{.holder_name}}.clear();
+	    {{.view_name}} = std::string_view();
 	}
 `,
 			args))
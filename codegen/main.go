@@ -66,11 +66,15 @@ func processMessage(ctx *Context, m *descriptor.DescriptorProto) {
 
 	for _, field := range m.GetField() {
 		processField(msg_printer, field)
+		msg_printer.clear_calls = append(msg_printer.clear_calls, "clear_"+field.GetName()+"();")
 	}
-	printDescriptor(m, ctx.printer, msg_printer)
+	printDescriptor(m, ctx, msg_printer)
 	printReflection(m, ctx.printer, msg_printer)
+	printTagConstants(m, ctx, msg_printer)
 	printComputeEncodedSize(m, ctx, msg_printer)
 	printEncoder(m, ctx, msg_printer)
+	printParseTable(m, ctx, msg_printer)
+	printDecoder(m, ctx, msg_printer)
 
 	ctx.printer.definitions += msg_printer.printClassDefinition()
 
@@ -94,6 +98,14 @@ func (mp *MessagePrinter) printClassDefinition() string {
 	out += "    ~" + mp.full_name + "() {}\n"
 	out += "\n"
 
+	// Clear
+	out += "    void Clear() override {\n"
+	for _, call := range mp.clear_calls {
+		out += "        " + call + "\n"
+	}
+	out += "    }\n"
+	out += "\n"
+
 	out += mp.publics
 	out += "\n"
 	out += "private:\n"
@@ -112,15 +124,50 @@ func outputName(f *descriptor.FileDescriptorProto) string {
 	return strings.Join(strs, ".")
 }
 
+// Options passed to the plugin, e.g. --deca_cpp_out=decoder=table:out_dir
+type Options struct {
+	// How DecodeImpl of messages is generated.
+	// "generated": decodes fields with code generated per message (default)
+	// "table": decodes fields with the table-driven parser in the runtime
+	decoder string
+}
+
+func parseOptions(param string) Options {
+	options := Options{
+		decoder: "generated",
+	}
+	for _, opt := range strings.Split(param, ",") {
+		if opt == "" {
+			continue
+		}
+		key, value, _ := strings.Cut(opt, "=")
+		switch key {
+		case "decoder":
+			if value != "generated" && value != "table" {
+				log.Fatal("Unknown decoder: ", value)
+			}
+			options.decoder = value
+		default:
+			log.Fatal("Unknown option: ", opt)
+		}
+	}
+	return options
+}
+
 type Context struct {
 	printer        *FilePrinter
 	cpp_nested_pkg []string
+	options        Options
+	// Whether the file being processed is proto3, where repeated scalar
+	// fields are packed by default.
+	proto3 bool
 }
 
-func NewContext() *Context {
+func NewContext(options Options) *Context {
 	return &Context{
 		printer:        NewFilePrinter(),
 		cpp_nested_pkg: []string{},
+		options:        options,
 	}
 }
 
@@ -153,6 +200,9 @@ type MessagePrinter struct {
 
 	init_default_values []string
 
+	// Calls of the clearer of each field, which makes Clear()
+	clear_calls []string
+
 	// TODO: We need one descriptor pinters per message
 	descriptor_printer *DescriptorPrinter
 }
@@ -235,6 +285,8 @@ func processReq(req *plugin.CodeGeneratorRequest) *plugin.CodeGeneratorResponse
 		files[f.GetName()] = f
 	}
 
+	options := parseOptions(req.GetParameter())
+
 	var resp plugin.CodeGeneratorResponse
 	for _, fname := range req.FileToGenerate {
 		f := files[fname]
@@ -257,16 +309,20 @@ func processReq(req *plugin.CodeGeneratorRequest) *plugin.CodeGeneratorResponse
 		out_file_name := outputName(f)
 		header_file_name := out_file_name + ".h"
 
-		ctx := NewContext()
+		ctx := NewContext(options)
+		ctx.proto3 = f.GetSyntax() == "proto3"
 
+		ctx.printer.addInclude("#include <cassert>")
 		ctx.printer.addInclude("#include <memory>")
 		ctx.printer.addInclude("#include <stdint.h>")
 		ctx.printer.addInclude("#include <string>")
+		ctx.printer.addInclude("#include <string_view>")
 		ctx.printer.addInclude("#include <vector>")
 		ctx.printer.addInclude("#include \"decaproto/message.h\"")
 		ctx.printer.addInclude("#include \"decaproto/descriptor.h\"")
 		ctx.printer.addInclude("#include \"decaproto/reflection.h\"")
 		ctx.printer.addInclude("#include \"decaproto/field.h\"")
+		ctx.printer.addInclude("#include \"decaproto/table_parser.h\"")
 
 		for _, dep := range f.Dependency {
 			ctx.printer.addInclude("#include \"" + outputName(files[dep]) + ".h\"")
@@ -275,7 +331,9 @@ func processReq(req *plugin.CodeGeneratorRequest) *plugin.CodeGeneratorResponse
 		ctx.printer.source_content += "#include \"" + header_file_name + "\"\n"
 		ctx.printer.source_content += "\n"
 		ctx.printer.source_content += "#include <cassert>\n"
+		ctx.printer.source_content += "#include <cstddef>\n"
 		ctx.printer.source_content += "#include \"decaproto/reflection_util.h\"\n"
+		ctx.printer.source_content += "#include \"decaproto/decoder.h\"\n"
 		ctx.printer.source_content += "#include \"decaproto/encoder.h\"\n"
 		ctx.printer.source_content += "#include \"decaproto/stream/coded_stream.h\"\n"
 		ctx.printer.source_content += "\n"
@@ -71,6 +71,21 @@ func printReflection(m *descriptor.DescriptorProto, fp *FilePrinter, mp *Message
 						"msg_full_name":  msg_full_name,
 						"field_name":     f.GetName(),
 					})
+				if getWireType(f) != wireTypeLen {
+					// Lets the decoder append packed values at once
+					src += print("reg_mutable_repeated_field", `
+			{{.singleton_name}}->RegisterMutableRepeated{{.cc_camel_name}}Field(
+				{{.tag}},
+				decaproto::MsgCast(&{{.msg_full_name}}::mutable_{{.field_name}}));
+		`,
+						map[string]string{
+							"singleton_name": singleton_name,
+							"cc_camel_name":  type_name.cc_camel_name,
+							"tag":            tag_str,
+							"msg_full_name":  msg_full_name,
+							"field_name":     f.GetName(),
+						})
+				}
 			}
 		} else if f.GetType() == descriptor.FieldDescriptorProto_TYPE_ENUM {
 			src += print("reg_enum_field", `
@@ -101,6 +116,14 @@ func printReflection(m *descriptor.DescriptorProto, fp *FilePrinter, mp *Message
     {{.singleton_name}}->RegisterGet{{.cc_camel_name}}(
         {{.tag}},
 		decaproto::MsgCast(&{{.msg_full_name}}::{{.field_name}}));
+    // Getter for {{.field_name}} which works even if it's aliased
+    {{.singleton_name}}->RegisterGetStringView(
+        {{.tag}},
+		decaproto::MsgCast(&{{.msg_full_name}}::{{.field_name}}_view));
+    // Aliasing setter for {{.field_name}}
+    {{.singleton_name}}->RegisterSetStringView(
+        {{.tag}},
+		decaproto::MsgCast(&{{.msg_full_name}}::set_{{.field_name}}_alias));
 `,
 				map[string]string{
 					"singleton_name": singleton_name,
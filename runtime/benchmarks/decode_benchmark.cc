@@ -0,0 +1,96 @@
+// Compares the decoders of generated messages:
+//
+//   - Reflection: DecodeMessage() with the reflection and the descriptor
+//   - DecodeImpl: the decoder generated per message
+//   - ParseWithTable: the table-driven parser in the runtime
+//
+//   bazel run -c opt //runtime/benchmarks:decode_benchmark
+//
+// When the messages are generated with `decoder=table`, DecodeImpl uses the
+// table too, so DecodeImpl and ParseWithTable should match.
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+#include "decaproto/decoder.h"
+#include "decaproto/stream/coded_stream.h"
+#include "decaproto/stream/string_stream.h"
+#include "decaproto/table_parser.h"
+#include "runtime/benchmarks/benchmark.pb.h"
+
+using namespace decaproto;
+using namespace std;
+
+namespace {
+
+const int kIterations = 200000;
+
+Record MakeRecord() {
+    Record record;
+    record.set_id(1234567890123);
+    record.set_name("living room");
+    record.set_active(true);
+    for (uint32_t i = 0; i < 16; i++) {
+        record.mutable_counters()->push_back(i * 37);
+    }
+    for (uint32_t i = 0; i < 8; i++) {
+        Sample* sample = record.add_samples();
+        sample->set_sensor_id(i);
+        sample->set_value(-static_cast<int32_t>(i) * 100);
+        sample->set_temperature(21.5f + i);
+        sample->set_timestamp(1700000000.0 + i);
+        sample->set_status(i % 3 == 0 ? STATUS_ERROR : STATUS_OK);
+    }
+    record.mutable_tags()->push_back("indoor");
+    record.mutable_tags()->push_back("sensor");
+    return record;
+}
+
+template <typename F>
+void Run(const string& name, const string& data, F decode) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data.data());
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < kIterations; i++) {
+        Record record;
+        CodedInputStream cis(bytes, data.size());
+        if (!decode(cis, record) || record.samples().size() != 8) {
+            cerr << name << ": failed to decode" << endl;
+            return;
+        }
+    }
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    double per_sec = kIterations / elapsed.count();
+    double mb_per_sec = data.size() * per_sec / 1e6;
+    cout << "  " << name << ": " << per_sec / 1e3 << " K messages/s, "
+         << mb_per_sec << " MB/s" << endl;
+}
+
+}  // namespace
+
+int main() {
+    string data;
+    {
+        StringOutputStream out(&data);
+        CodedOutputStream cos(&out);
+        MakeRecord().EncodeImpl(cos);
+    }
+    cout << "Record (" << data.size() << " bytes)" << endl;
+
+    Run("Reflection", data, [](CodedInputStream& cis, Record& record) {
+        return DecodeMessage(
+                cis,
+                SIZE_MAX,
+                &record,
+                record.GetReflection(),
+                record.GetDescriptor());
+    });
+    Run("DecodeImpl", data, [](CodedInputStream& cis, Record& record) {
+        return DecodeMessage(cis, SIZE_MAX, &record);
+    });
+    Run("ParseWithTable", data, [](CodedInputStream& cis, Record& record) {
+        return ParseWithTable(cis, Record::kParseTable, &record);
+    });
+    return 0;
+}
@@ -0,0 +1,100 @@
+// Compares decoding a run of varints one by one with ReadVarint32 against
+// DecodeVarintBatch with each kernel available on this CPU.
+//
+//   bazel run -c opt //runtime/benchmarks:varint_batch_benchmark
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "decaproto/stream/coded_stream.h"
+#include "decaproto/stream/string_stream.h"
+#include "decaproto/stream/varint_batch.h"
+
+using namespace decaproto;
+using namespace std;
+
+namespace {
+
+const size_t kElements = 1 << 20;
+const int kIterations = 20;
+
+// Encodes `kElements` values. `long_ratio` of them take 2-3 bytes and the
+// rest take 1 byte.
+string MakeData(double long_ratio) {
+    mt19937 rng(1234);
+    uniform_real_distribution<double> ratio(0.0, 1.0);
+    string data;
+    {
+        StringOutputStream out(&data);
+        CodedOutputStream cos(&out);
+        for (size_t i = 0; i < kElements; i++) {
+            uint32_t value =
+                    ratio(rng) < long_ratio ? rng() % 100000 : rng() % 128;
+            cos.WriteVarint32(value);
+        }
+    }
+    return data;
+}
+
+template <typename F>
+void Run(const string& name, F decode) {
+    vector<uint32_t> result;
+    result.reserve(kElements);
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < kIterations; i++) {
+        result.clear();
+        if (!decode(result) || result.size() != kElements) {
+            cerr << name << ": failed to decode" << endl;
+            return;
+        }
+    }
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    double per_sec = kElements * kIterations / elapsed.count();
+    cout << "  " << name << ": " << per_sec / 1e6 << " M elements/s" << endl;
+}
+
+void RunAll(const string& title, const string& data) {
+    cout << title << " (" << data.size() << " bytes)" << endl;
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data.data());
+
+    Run("ReadVarint32", [&](vector<uint32_t>& result) {
+        CodedInputStream cis(bytes, data.size());
+        uint32_t value;
+        while (cis.ConsumedSize() < data.size()) {
+            if (!cis.ReadVarint32(value)) {
+                return false;
+            }
+            result.push_back(value);
+        }
+        return true;
+    });
+
+    const pair<VarintBatchKernel, string> kernels[] = {
+            {kVarintBatchScalar, "DecodeVarintBatch (scalar)"},
+            {kVarintBatchSse41, "DecodeVarintBatch (SSE4.1)"},
+            {kVarintBatchAvx2, "DecodeVarintBatch (AVX2)"},
+    };
+    for (const auto& kernel : kernels) {
+        if (kernel.first > GetVarintBatchKernel()) {
+            continue;
+        }
+        SetVarintBatchKernel(kernel.first);
+        Run(kernel.second, [&](vector<uint32_t>& result) {
+            return DecodeVarintBatch(bytes, data.size(), result);
+        });
+    }
+    SetVarintBatchKernel(GetVarintBatchKernel());
+}
+
+}  // namespace
+
+int main() {
+    RunAll("1-byte values", MakeData(0.0));
+    RunAll("10% multi-byte values", MakeData(0.1));
+    RunAll("50% multi-byte values", MakeData(0.5));
+    return 0;
+}
@@ -1,5 +1,6 @@
 #include "decaproto/decoder.h"
 
+#include "decaproto/encoder.h"
 #include "decaproto/message.h"
 #include "decaproto/stream/coded_stream.h"
 #include "decaproto/stream/stream.h"
@@ -8,6 +9,7 @@
 //    Instead, we should privide a way to inject a logger.
 #include <cstring>
 #include <iostream>
+#include <vector>
 
 // https://protobuf.dev/programming-guides/encoding/
 /*
@@ -44,36 +46,6 @@ using namespace std;
 
 namespace decaproto {
 
-namespace {
-
-template <typename SRC_T, typename DST_T>
-DST_T MemcpyCast(SRC_T src) {
-    return (DST_T)src;
-}
-
-template <>
-double MemcpyCast<uint64_t, double>(uint64_t src) {
-    double dst = 0;
-    memcpy(&dst, &src, sizeof(src));
-    return dst;
-}
-
-template <>
-float MemcpyCast<uint32_t, float>(uint32_t src) {
-    float dst = 0;
-    memcpy(&dst, &src, sizeof(src));
-    return dst;
-}
-
-}  // namespace
-
-bool DecodeMessage(
-        CodedInputStream& cis,
-        size_t size,
-        Message* message,
-        const Reflection* reflection,
-        const Descriptor* descriptor);
-
 bool DecodeTag(
         CodedInputStream& cis, uint32_t& field_number, WireType& wire_type) {
     // tag        := (field << 3) bit-or wire_type;
@@ -115,7 +87,9 @@ bool SkipUnknownField(CodedInputStream& cis, WireType wire_type) {
             if (!cis.ReadVarint32(len)) {
                 return false;
             }
-            cis.Skip(len);
+            if (!cis.Skip(len)) {
+                return false;
+            }
             break;
         }
         case kDeprecated_SGroup:
@@ -125,16 +99,11 @@ bool SkipUnknownField(CodedInputStream& cis, WireType wire_type) {
     return true;
 }
 
-bool DecodeVarint(
-        CodedInputStream& cis,
+bool SetVarintField(
         Message* message,
         const Reflection* reflection,
-        const FieldDescriptor* field) {
-    uint64_t value;
-    if (!cis.ReadVarint64(value)) {
-        return false;
-    }
-
+        const FieldDescriptor* field,
+        uint64_t value) {
     uint32_t tag = field->GetFieldNumber();
     switch (field->GetType()) {
         case kInt32:
@@ -204,18 +173,23 @@ bool DecodeVarint(
     return true;
 }
 
-bool DecodeFixedInt32(
+bool DecodeVarint(
         CodedInputStream& cis,
         Message* message,
         const Reflection* reflection,
         const FieldDescriptor* field) {
-    // i32        := sfixed32 | fixed32 | float;
-    //                 encoded as 4-byte little-endian;
-    //                 memcpy of the equivalent C types (u?int32_t, float)
-    uint32_t value;
-    if (!cis.ReadFixedInt32(value)) {
+    uint64_t value;
+    if (!cis.ReadVarint64(value)) {
         return false;
     }
+    return SetVarintField(message, reflection, field, value);
+}
+
+bool SetFixedInt32Field(
+        Message* message,
+        const Reflection* reflection,
+        const FieldDescriptor* field,
+        uint32_t value) {
     switch (field->GetType()) {
         case kFixed32:
             if (field->IsRepeated()) {
@@ -254,21 +228,26 @@ bool DecodeFixedInt32(
     return true;
 }
 
-bool DecodeFixedInt64(
+bool DecodeFixedInt32(
         CodedInputStream& cis,
         Message* message,
         const Reflection* reflection,
         const FieldDescriptor* field) {
-    // i64        := sfixed64 | fixed64 | double;
-    //                 encoded as 8-byte little-endian;
-    //                 memcpy of the equivalent C types (u?int64_t, double)
-    //
-    uint64_t value;
-    if (!cis.ReadFixedInt64(value)) {
-        std::cerr << "Failed to read fixed64. field number: "
-                  << field->GetFieldNumber() << endl;
+    // i32        := sfixed32 | fixed32 | float;
+    //                 encoded as 4-byte little-endian;
+    //                 memcpy of the equivalent C types (u?int32_t, float)
+    uint32_t value;
+    if (!cis.ReadFixedInt32(value)) {
         return false;
     }
+    return SetFixedInt32Field(message, reflection, field, value);
+}
+
+bool SetFixedInt64Field(
+        Message* message,
+        const Reflection* reflection,
+        const FieldDescriptor* field,
+        uint64_t value) {
     switch (field->GetType()) {
         case kFixed64:
             if (field->IsRepeated()) {
@@ -307,6 +286,47 @@ bool DecodeFixedInt64(
     return false;
 }
 
+bool DecodeFixedInt64(
+        CodedInputStream& cis,
+        Message* message,
+        const Reflection* reflection,
+        const FieldDescriptor* field) {
+    // i64        := sfixed64 | fixed64 | double;
+    //                 encoded as 8-byte little-endian;
+    //                 memcpy of the equivalent C types (u?int64_t, double)
+    //
+    uint64_t value;
+    if (!cis.ReadFixedInt64(value)) {
+        std::cerr << "Failed to read fixed64. field number: "
+                  << field->GetFieldNumber() << endl;
+        return false;
+    }
+    return SetFixedInt64Field(message, reflection, field, value);
+}
+
+string* MutableStringField(
+        Message* message,
+        const Reflection* reflection,
+        const FieldDescriptor* field) {
+    // TODO: Implement Reflection::MutableString so that we can set
+    // string w/o memory allocation here.
+    if (field->IsRepeated()) {
+        return reflection->AddRepeatedString(message, field->GetFieldNumber());
+    }
+    return reflection->MutableString(message, field->GetFieldNumber());
+}
+
+Message* MutableMessageField(
+        Message* message,
+        const Reflection* reflection,
+        const FieldDescriptor* field) {
+    if (field->IsRepeated()) {
+        return reflection->AddRepeatedMessage(
+                message, field->GetFieldNumber());
+    }
+    return reflection->MutableMessage(message, field->GetFieldNumber());
+}
+
 bool DecodeLenPrefix(
         CodedInputStream& cis,
         Message* message,
@@ -321,18 +341,20 @@ bool DecodeLenPrefix(
         return false;
     }
 
-    uint32_t tag = field->GetFieldNumber();
-
     switch (field->GetType()) {
         case kString: {
-            // TODO: Implement Reflection::MutableString so that we can set
-            // string w/o memory allocation here.
-            string* value;
-            if (field->IsRepeated()) {
-                value = reflection->AddRepeatedString(message, tag);
-            } else {
-                value = reflection->MutableString(message, tag);
+            std::string_view view;
+            if (cis.AliasingEnabled() && cis.ReadStringView(view, size)) {
+                if (field->IsRepeated() ||
+                    !reflection->SetStringView(
+                            message, field->GetFieldNumber(), view)) {
+                    // The field can't refer to the buffer.
+                    MutableStringField(message, reflection, field)
+                            ->assign(view.data(), view.size());
+                }
+                return true;
             }
+            string* value = MutableStringField(message, reflection, field);
             if (!cis.ReadString(*value, size)) {
                 cerr << "Failed to read string" << endl;
                 return false;
@@ -344,18 +366,9 @@ bool DecodeLenPrefix(
             return false;
         }
         case kMessage: {
-            Message* sub_message;
-            if (field->IsRepeated()) {
-                sub_message = reflection->AddRepeatedMessage(message, tag);
-            } else {
-                sub_message = reflection->MutableMessage(message, tag);
-            }
-            return DecodeMessage(
-                    cis,
-                    size,
-                    sub_message,
-                    sub_message->GetReflection(),
-                    sub_message->GetDescriptor());
+            Message* sub_message =
+                    MutableMessageField(message, reflection, field);
+            return DecodeMessage(cis, size, sub_message);
         }
         default:
             cerr << "This field is not a len-prefix field. tag: "
@@ -366,9 +379,157 @@ bool DecodeLenPrefix(
     return true;
 }
 
-bool DecodeMessage(
+namespace {
+
+// Appends the values of a packed field read by `read` to `values` at once,
+// or adds them one by one with `add` if the message doesn't expose the
+// vector of the field.
+template <typename T, typename ReadFn, typename AddFn>
+bool DecodePackedValues(std::vector<T>* values, ReadFn read, AddFn add) {
+    if (values != nullptr) {
+        return read(*values);
+    }
+    std::vector<T> decoded;
+    if (!read(decoded)) {
+        return false;
+    }
+    for (T value : decoded) {
+        *add() = value;
+    }
+    return true;
+}
+
+bool DecodePacked(
+        CodedInputStream& cis,
+        Message* message,
+        const Reflection* reflection,
+        const FieldDescriptor* field) {
+    // packed     := size (value)*;
+    //               values are encoded without tags
+    uint32_t size;
+    if (!cis.ReadVarint32(size)) {
+        cerr << "Failed to read `size` of packed field" << endl;
+        return false;
+    }
+
+    uint32_t tag = field->GetFieldNumber();
+    auto varints = [&](auto& values) {
+        return cis.ReadVarintArray(values, size);
+    };
+    auto zigzag_varints = [&](auto& values) {
+        return cis.ReadVarintArray(values, size, true);
+    };
+    // The vector is grown to fit all values up front.
+    auto fixed = [&](auto& values) { return cis.ReadFixedArray(values, size); };
+
+    switch (field->GetType()) {
+        case kInt32:
+            return DecodePackedValues(
+                    reflection->MutableRepeatedInt32Field(message, tag),
+                    varints,
+                    [&]() {
+                        return reflection->AddRepeatedInt32(message, tag);
+                    });
+        case kInt64:
+            return DecodePackedValues(
+                    reflection->MutableRepeatedInt64Field(message, tag),
+                    varints,
+                    [&]() {
+                        return reflection->AddRepeatedInt64(message, tag);
+                    });
+        case kUint32:
+            return DecodePackedValues(
+                    reflection->MutableRepeatedUint32Field(message, tag),
+                    varints,
+                    [&]() {
+                        return reflection->AddRepeatedUint32(message, tag);
+                    });
+        case kUint64:
+            return DecodePackedValues(
+                    reflection->MutableRepeatedUint64Field(message, tag),
+                    varints,
+                    [&]() {
+                        return reflection->AddRepeatedUint64(message, tag);
+                    });
+        case kSint32:
+            return DecodePackedValues(
+                    reflection->MutableRepeatedSint32Field(message, tag),
+                    zigzag_varints,
+                    [&]() {
+                        return reflection->AddRepeatedSint32(message, tag);
+                    });
+        case kSint64:
+            return DecodePackedValues(
+                    reflection->MutableRepeatedSint64Field(message, tag),
+                    zigzag_varints,
+                    [&]() {
+                        return reflection->AddRepeatedSint64(message, tag);
+                    });
+        case kBool:
+            return DecodePackedValues(
+                    reflection->MutableRepeatedBoolField(message, tag),
+                    varints,
+                    [&]() {
+                        return reflection->AddRepeatedBool(message, tag);
+                    });
+        case kEnum:
+            // Vectors of generated enums can't be exposed as vector<int>.
+            return DecodePackedValues<int>(nullptr, varints, [&]() {
+                return reflection->AddRepeatedEnumValue(message, tag);
+            });
+        case kFixed32:
+            return DecodePackedValues(
+                    reflection->MutableRepeatedFixed32Field(message, tag),
+                    fixed,
+                    [&]() {
+                        return reflection->AddRepeatedFixed32(message, tag);
+                    });
+        case kSfixed32:
+            return DecodePackedValues(
+                    reflection->MutableRepeatedSfixed32Field(message, tag),
+                    fixed,
+                    [&]() {
+                        return reflection->AddRepeatedSfixed32(message, tag);
+                    });
+        case kFloat:
+            return DecodePackedValues(
+                    reflection->MutableRepeatedFloatField(message, tag),
+                    fixed,
+                    [&]() {
+                        return reflection->AddRepeatedFloat(message, tag);
+                    });
+        case kFixed64:
+            return DecodePackedValues(
+                    reflection->MutableRepeatedFixed64Field(message, tag),
+                    fixed,
+                    [&]() {
+                        return reflection->AddRepeatedFixed64(message, tag);
+                    });
+        case kSfixed64:
+            return DecodePackedValues(
+                    reflection->MutableRepeatedSfixed64Field(message, tag),
+                    fixed,
+                    [&]() {
+                        return reflection->AddRepeatedSfixed64(message, tag);
+                    });
+        case kDouble:
+            return DecodePackedValues(
+                    reflection->MutableRepeatedDoubleField(message, tag),
+                    fixed,
+                    [&]() {
+                        return reflection->AddRepeatedDouble(message, tag);
+                    });
+        default:
+            cerr << "This field can't be packed. tag: " << tag
+                 << ", field type: " << field->GetType() << endl;
+            return false;
+    }
+}
+
+// Decodes fields until the current limit of `cis`, or until the end of the
+// stream if no limit is pushed.
+bool DecodeFields(
         CodedInputStream& cis,
-        size_t size,
         Message* message,
         const Reflection* reflection,
         const Descriptor* descriptor) {
@@ -377,9 +538,12 @@ bool DecodeMessage(
     uint32_t field_number;
     WireType wire_type;
 
-    size_t consumed_start_size = cis.ConsumedSize();
-    while ((cis.ConsumedSize() - consumed_start_size) < size &&
-           DecodeTag(cis, field_number, wire_type)) {
+    while (!cis.ReachedLimit()) {
+        if (!DecodeTag(cis, field_number, wire_type)) {
+            // The stream ended. It's fine only if the message isn't sized,
+            // otherwise the data is truncated.
+            return cis.BytesUntilLimit() == SIZE_MAX;
+        }
         const FieldDescriptor* field =
                 descriptor->FindFieldByNumber(field_number);
         if (field == nullptr) {
@@ -390,7 +554,21 @@ bool DecodeMessage(
             // we can encode the message again without losing any
             // information.
             cerr << "Unknown field number: " << field_number << endl;
-            SkipUnknownField(cis, wire_type);
+            if (!SkipUnknownField(cis, wire_type)) {
+                cerr << "Failed to skip the unknown field. field number: "
+                     << field_number << endl;
+                return false;
+            }
+            continue;
+        }
+        if (wire_type == kLen && IsPackable(*field)) {
+            // Repeated scalars may be packed whether the field is declared
+            // packed or not.
+            if (!DecodePacked(cis, message, reflection, field)) {
+                std::cerr << "Failed to decode packed field. field number: "
+                          << field->GetFieldNumber() << endl;
+                return false;
+            }
             continue;
         }
         if (GetWireType(field->GetType()) != wire_type) {
@@ -405,11 +583,6 @@ bool DecodeMessage(
             return false;
         }
 
-        if (field->IsPacked()) {
-            std::cerr << "Packed field is not supported yet." << endl;
-            return false;
-        }
-
         switch (wire_type) {
             case kVarint:
                 if (!DecodeVarint(cis, message, reflection, field)) {
@@ -449,24 +622,77 @@ bool DecodeMessage(
         }
     }
 
+    return true;
+}
+
+// Runs `decode` with a limit of `size` bytes pushed to `cis`.
+template <typename F>
+bool DecodeSized(CodedInputStream& cis, size_t size, F decode) {
     if (size == SIZE_MAX) {
-        // The callder doesn't care about the message size.
-        return true;
+        // The caller doesn't care about the message size.
+        return decode();
     }
 
-    if ((cis.ConsumedSize() - consumed_start_size) != size) {
-        cerr << "The message size is not matched. Expected: " << size
-             << ", Consumed: " << (cis.ConsumedSize() - consumed_start_size)
-             << endl;
+    // Fields can't go beyond the end of the message, which is caught as
+    // soon as a read hits the limit.
+    if (!cis.PushLimit(size)) {
+        cerr << "The message exceeds the enclosing message. size: " << size
+             << ", remaining: " << cis.BytesUntilLimit() << endl;
+        return false;
+    }
+    bool result = decode();
+    if (!result) {
+        cerr << "The message is truncated or broken. size: " << size
+             << ", remaining: " << cis.BytesUntilLimit() << endl;
+    }
+    cis.PopLimit();
+    return result;
+}
+
+}  // namespace
+
+bool Message::DecodeImpl(CodedInputStream& stream) {
+    return DecodeFields(stream, this, GetReflection(), GetDescriptor());
+}
+
+bool DecodeMessage(CodedInputStream& cis, size_t size, Message* message) {
+    return DecodeSized(cis, size, [&]() { return message->DecodeImpl(cis); });
+}
+
+bool IsValidMessageSize(CodedInputStream& cis, uint64_t size) {
+    if (size >= SIZE_MAX || size > cis.BytesUntilLimit()) {
+        cerr << "Invalid message size: " << size
+             << ", remaining: " << cis.BytesUntilLimit() << endl;
         return false;
     }
     return true;
 }
 
+bool DecodeMessage(
+        CodedInputStream& cis,
+        size_t size,
+        Message* message,
+        const Reflection* reflection,
+        const Descriptor* descriptor) {
+    return DecodeSized(cis, size, [&]() {
+        return DecodeFields(cis, message, reflection, descriptor);
+    });
+}
+
 bool DecodeMessage(InputStream& ins, Message* out) {
     CodedInputStream cis(&ins);
-    return DecodeMessage(
-            cis, SIZE_MAX, out, out->GetReflection(), out->GetDescriptor());
+    return DecodeMessage(cis, SIZE_MAX, out);
+}
+
+bool DecodeMessage(ZeroCopyInputStream& ins, Message* out) {
+    CodedInputStream cis(&ins);
+    return DecodeMessage(cis, SIZE_MAX, out);
+}
+
+bool DecodeMessageAliasing(const uint8_t* data, size_t size, Message* out) {
+    CodedInputStream cis(data, size);
+    cis.EnableAliasing(true);
+    return DecodeMessage(cis, SIZE_MAX, out);
 }
 
 }  // namespace decaproto
\ No newline at end of file
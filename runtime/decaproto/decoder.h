@@ -1,9 +1,12 @@
 #ifndef DECAPROTO_DECODER_H
 #define DECAPROTO_DECODER_H
 
+#include <string>
+
 #include "decaproto/descriptor.h"
 #include "decaproto/message.h"
 #include "decaproto/stream/stream.h"
+#include "decaproto/stream/zero_copy_stream.h"
 
 namespace decaproto {
 
@@ -35,7 +38,74 @@ inline WireType GetWireType(FieldType type) {
     }
 };
 
+// True if `field` can be encoded packed, i.e. as one len-prefix record which
+// holds all the values back to back. Decoders must accept both encodings of
+// such fields whatever IsPacked() says.
+inline bool IsPackable(const FieldDescriptor& field) {
+    return field.IsRepeated() && GetWireType(field.GetType()) != kLen;
+}
+
+// Stores a decoded value into `field` of `message`.
+// Returns false if the type of `field` doesn't match the value.
+bool SetVarintField(
+        Message* message,
+        const Reflection* reflection,
+        const FieldDescriptor* field,
+        uint64_t value);
+bool SetFixedInt32Field(
+        Message* message,
+        const Reflection* reflection,
+        const FieldDescriptor* field,
+        uint32_t value);
+bool SetFixedInt64Field(
+        Message* message,
+        const Reflection* reflection,
+        const FieldDescriptor* field,
+        uint64_t value);
+
+// Returns the string or the sub message to decode `field` into.
+// A new element is added for repeated fields.
+std::string* MutableStringField(
+        Message* message,
+        const Reflection* reflection,
+        const FieldDescriptor* field);
+Message* MutableMessageField(
+        Message* message,
+        const Reflection* reflection,
+        const FieldDescriptor* field);
+
+// Skips the value of a field which isn't defined in the message.
+bool SkipUnknownField(CodedInputStream& cis, WireType wire_type);
+
+// Decodes a message of exactly `size` bytes from `cis` with
+// Message::DecodeImpl(). Pass SIZE_MAX to decode until the end of the stream.
+bool DecodeMessage(CodedInputStream& cis, size_t size, Message* message);
+
+// Checks a message size read from a length prefix before it's passed to
+// DecodeMessage(). A prefix of SIZE_MAX or more would otherwise turn into an
+// unsized decode (or be truncated on 32-bit targets), so it's rejected
+// together with sizes beyond the current limit of `cis`.
+bool IsValidMessageSize(CodedInputStream& cis, uint64_t size);
+
+// Same as above, but always goes through `reflection` and `descriptor`
+// instead of the decoder of the message.
+bool DecodeMessage(
+        CodedInputStream& cis,
+        size_t size,
+        Message* message,
+        const Reflection* reflection,
+        const Descriptor* descriptor);
+
 bool DecodeMessage(InputStream& stream, Message* out);
+bool DecodeMessage(ZeroCopyInputStream& stream, Message* out);
+
+// Decodes `size` bytes starting from `data` into `out`. String fields refer
+// to `data` instead of holding copies where the message supports it (see
+// CodedInputStream::EnableAliasing), so `data` must outlive `out`. Read such
+// fields of generated messages with xxx_view() (or
+// Reflection::GetStringView()), since xxx() asserts that the field isn't
+// aliased.
+bool DecodeMessageAliasing(const uint8_t* data, size_t size, Message* out);
 
 }  // namespace decaproto
 
@@ -0,0 +1,52 @@
+#include "decaproto/delimited.h"
+
+#include "decaproto/decoder.h"
+
+namespace decaproto {
+
+bool EncodeDelimited(const Message& message, CodedOutputStream& cos) {
+    if (!cos.WriteVarint64(message.ComputeEncodedSize())) {
+        return false;
+    }
+    return message.EncodeImpl(cos) && !cos.HadError();
+}
+
+bool EncodeDelimited(const Message& message, OutputStream& stream) {
+    CodedOutputStream cos(&stream);
+    return EncodeDelimited(message, cos);
+}
+
+bool DecodeDelimited(CodedInputStream& cis, Message* out) {
+    uint64_t size;
+    if (!cis.ReadVarint64(size) || !IsValidMessageSize(cis, size)) {
+        return false;
+    }
+    return DecodeMessage(cis, size, out);
+}
+
+bool DecodeDelimited(InputStream& stream, Message* out) {
+    CodedInputStream cis(&stream);
+    return DecodeDelimited(cis, out);
+}
+
+bool DelimitedReader::Next(Message* out) {
+    if (had_error_) {
+        return false;
+    }
+
+    out->Clear();
+    size_t consumed_start_size = cis_.ConsumedSize();
+    uint64_t size;
+    if (!cis_.ReadVarint64(size)) {
+        // Nothing consumed means the stream ended at a message boundary.
+        had_error_ = cis_.ConsumedSize() != consumed_start_size;
+        return false;
+    }
+    if (!IsValidMessageSize(cis_, size) || !DecodeMessage(cis_, size, out)) {
+        had_error_ = true;
+        return false;
+    }
+    return true;
+}
+
+}  // namespace decaproto
@@ -0,0 +1,77 @@
+#ifndef DECAPROTO_DELIMITED_H
+#define DECAPROTO_DELIMITED_H
+
+#include "decaproto/message.h"
+#include "decaproto/stream/coded_stream.h"
+#include "decaproto/stream/stream.h"
+#include "decaproto/stream/zero_copy_stream.h"
+
+namespace decaproto {
+
+// Length-delimited framing which allows a stream to carry multiple messages.
+//
+// Each message is written as a varint of its encoded size followed by the
+// encoded message, which is compatible with writeDelimitedTo() and
+// parseDelimitedFrom() of the official protobuf libraries.
+
+// Writes `message` with its size prefix.
+bool EncodeDelimited(const Message& message, CodedOutputStream& cos);
+bool EncodeDelimited(const Message& message, OutputStream& stream);
+
+// Reads a size prefix and decodes exactly that many bytes into `out`.
+// `out` isn't cleared beforehand, so fields are merged into it.
+bool DecodeDelimited(CodedInputStream& cis, Message* out);
+bool DecodeDelimited(InputStream& stream, Message* out);
+
+// Walks a stream of length-delimited messages.
+//
+// Next() relies on Message::Clear() to reset the message between reads.
+// Generated messages override it, but the default does nothing, so a
+// hand-written message which doesn't override it accumulates the fields of
+// all of the messages read so far.
+//
+//   DelimitedReader reader(&stream);
+//   Telemetry record;
+//   while (reader.Next(&record)) {
+//       Handle(record);
+//   }
+//   if (reader.HadError()) {
+//       // The stream is broken
+//   }
+class DelimitedReader {
+    CodedInputStream cis_;
+    bool had_error_;
+
+public:
+    DelimitedReader(InputStream* stream) : cis_(stream), had_error_(false) {
+    }
+
+    DelimitedReader(ZeroCopyInputStream* stream)
+        : cis_(stream), had_error_(false) {
+    }
+
+    DelimitedReader(const uint8_t* data, size_t size)
+        : cis_(data, size), had_error_(false) {
+    }
+
+    // Clears `out` and decodes the next message into it so that one message
+    // object can be reused for all of the messages (see the note above about
+    // messages which don't override Message::Clear()).
+    // Returns false if the stream ended at a message boundary or is broken.
+    bool Next(Message* out);
+
+    // True if Next() returned false because the stream is broken (e.g. it
+    // ends in the middle of a message) rather than simply ended.
+    bool HadError() const {
+        return had_error_;
+    }
+
+    // How many bytes have been consumed from the stream.
+    size_t ConsumedSize() {
+        return cis_.ConsumedSize();
+    }
+};
+
+}  // namespace decaproto
+
+#endif  // DECAPROTO_DELIMITED_H
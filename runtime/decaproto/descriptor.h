@@ -3,6 +3,7 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <utility>
 #include <vector>
 
 namespace decaproto {
@@ -80,10 +81,51 @@ public:
 // There are singletons for each message type which is accessible through
 // YourMessage::GetDescriptor()
 class Descriptor final {
+    static constexpr uint32_t kNoField = UINT32_MAX;
+
     std::vector<FieldDescriptor> fields_;
 
+    // Index from field numbers to fields_, rebuilt whenever a field is
+    // registered so that FindFieldByNumber() doesn't scan fields_.
+    //
+    // While field numbers are compact, dense_index_[n] is the index of the
+    // field whose number is n, or kNoField. Otherwise, sparse_index_ holds
+    // pairs of a field number and an index sorted by the number.
+    bool dense_;
+    std::vector<uint32_t> dense_index_;
+    std::vector<std::pair<uint32_t, uint32_t>> sparse_index_;
+
+    void BuildIndex() {
+        uint32_t max_number = 0;
+        for (const FieldDescriptor& field : fields_) {
+            max_number = std::max(max_number, field.GetFieldNumber());
+        }
+
+        // Accept some gaps (e.g. removed fields) but don't let a huge field
+        // number blow up the array.
+        dense_ = max_number <= fields_.size() * 2 + 16;
+        dense_index_.clear();
+        sparse_index_.clear();
+        if (dense_) {
+            dense_index_.resize(max_number + 1, kNoField);
+            // Iterate backwards so that the first field wins if a number is
+            // registered twice, as in the sorted index.
+            for (uint32_t i = fields_.size(); i > 0; i--) {
+                dense_index_[fields_[i - 1].GetFieldNumber()] = i - 1;
+            }
+            return;
+        }
+        sparse_index_.reserve(fields_.size());
+        for (uint32_t i = 0; i < fields_.size(); i++) {
+            sparse_index_.emplace_back(fields_[i].GetFieldNumber(), i);
+        }
+        // Sorting pairs keeps the first registered field first among fields
+        // with the same number.
+        std::sort(sparse_index_.begin(), sparse_index_.end());
+    }
+
 public:
-    Descriptor() {
+    Descriptor() : dense_(true) {
     }
 
     ~Descriptor() {
@@ -91,23 +133,34 @@ public:
 
     void RegisterField(const FieldDescriptor& field) {
         fields_.push_back(field);
+        BuildIndex();
     }
 
     const std::vector<FieldDescriptor>& GetFields() const {
         return fields_;
     }
 
+    // Constant time while field numbers are compact, and a binary search
+    // otherwise.
     const FieldDescriptor* FindFieldByNumber(uint32_t field_number) const {
-        auto f =
-                find_if(fields_.begin(),
-                        fields_.end(),
-                        [=](const FieldDescriptor& field) {
-                            return field.GetFieldNumber() == field_number;
-                        });
-        if (f == fields_.end()) {
+        if (dense_) {
+            if (field_number >= dense_index_.size() ||
+                dense_index_[field_number] == kNoField) {
+                return nullptr;
+            }
+            return &fields_[dense_index_[field_number]];
+        }
+        auto it = std::lower_bound(
+                sparse_index_.begin(),
+                sparse_index_.end(),
+                field_number,
+                [](const std::pair<uint32_t, uint32_t>& entry, uint32_t n) {
+                    return entry.first < n;
+                });
+        if (it == sparse_index_.end() || it->first != field_number) {
             return nullptr;
         }
-        return &(*f);
+        return &fields_[it->second];
     }
 };
 
@@ -4,6 +4,7 @@
 #include <cstring>
 
 #include "decaproto/message.h"
+#include "decaproto/stream/coded_stream.h"
 #include "decaproto/stream/stream.h"
 
 namespace decaproto {
@@ -33,13 +34,22 @@ inline uint32_t MemcpyCast<float, uint32_t>(float src) {
     return dst;
 }
 
+template <>
+inline double MemcpyCast<uint64_t, double>(uint64_t src) {
+    double dst = 0;
+    std::memcpy(&dst, &src, sizeof(src));
+    return dst;
+}
+
+template <>
+inline float MemcpyCast<uint32_t, float>(uint32_t src) {
+    float dst = 0;
+    std::memcpy(&dst, &src, sizeof(src));
+    return dst;
+}
+
 inline size_t ComputeEncodedVarintSize(uint64_t value) {
-    size_t size = 0;
-    do {
-        value >>= 7;
-        size++;
-    } while (value != 0);
-    return size;
+    return CodedOutputStream::VarintSize64(value);
 }
 
 }  // namespace decaproto
@@ -0,0 +1,67 @@
+#include "decaproto/framed.h"
+
+#include <iostream>
+
+#include "decaproto/decoder.h"
+#include "decaproto/stream/coded_stream.h"
+#include "decaproto/stream/crc32c.h"
+
+namespace decaproto {
+
+bool EncodeFramed(const Message& message, OutputStream& stream) {
+    size_t size = message.ComputeEncodedSize();
+    {
+        CodedOutputStream cos(&stream);
+        if (!cos.WriteVarint64(size)) {
+            return false;
+        }
+    }
+
+    Crc32cOutputStream crc_stream(&stream);
+    {
+        CodedOutputStream cos(&crc_stream);
+        if (!message.EncodeImpl(cos) || cos.HadError()) {
+            return false;
+        }
+    }
+    if (crc_stream.WrittenSize() != size) {
+        std::cerr << "Encoded size doesn't match the computed size: "
+                  << crc_stream.WrittenSize() << " vs " << size << std::endl;
+        return false;
+    }
+
+    CodedOutputStream cos(&stream);
+    return cos.WriteFixedInt32(crc_stream.Crc());
+}
+
+bool DecodeFramed(InputStream& stream, Message* out) {
+    uint64_t size;
+    {
+        CodedInputStream cis(&stream);
+        if (!cis.ReadVarint64(size)) {
+            return false;
+        }
+    }
+
+    Crc32cInputStream crc_stream(&stream);
+    {
+        CodedInputStream cis(&crc_stream);
+        if (!IsValidMessageSize(cis, size) || !DecodeMessage(cis, size, out)) {
+            return false;
+        }
+    }
+
+    uint32_t crc;
+    CodedInputStream cis(&stream);
+    if (!cis.ReadFixedInt32(crc)) {
+        return false;
+    }
+    if (crc != crc_stream.Crc()) {
+        std::cerr << "CRC32C mismatch: " << crc << " vs " << crc_stream.Crc()
+                  << std::endl;
+        return false;
+    }
+    return true;
+}
+
+}  // namespace decaproto
@@ -0,0 +1,31 @@
+#ifndef DECAPROTO_FRAMED_H
+#define DECAPROTO_FRAMED_H
+
+#include "decaproto/message.h"
+#include "decaproto/stream/stream.h"
+
+namespace decaproto {
+
+// Framing with an integrity check for records stored on disk or sent over
+// an unreliable link.
+//
+// Each record is written as
+//
+//   [size: varint][payload: encoded message][crc: fixed32]
+//
+// where crc is the CRC32C of the payload. The checksum is computed while the
+// payload passes through the stream (see Crc32cOutputStream and
+// Crc32cInputStream), so the payload isn't scanned again.
+
+// Writes `message` as a framed record.
+bool EncodeFramed(const Message& message, OutputStream& stream);
+
+// Reads a framed record and decodes its payload into `out`.
+// `out` isn't cleared beforehand, so fields are merged into it.
+// Returns false if the stream is broken or the checksum doesn't match. `out`
+// may have been modified even in that case.
+bool DecodeFramed(InputStream& stream, Message* out);
+
+}  // namespace decaproto
+
+#endif  // DECAPROTO_FRAMED_H
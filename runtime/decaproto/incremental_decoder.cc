@@ -0,0 +1,322 @@
+#include "decaproto/incremental_decoder.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+
+#include "decaproto/decoder.h"
+
+using namespace std;
+
+namespace decaproto {
+
+IncrementalDecoder::IncrementalDecoder(Message* out)
+    : IncrementalDecoder(out, SIZE_MAX) {
+}
+
+IncrementalDecoder::IncrementalDecoder(Message* out, size_t size)
+    : state_(kReadTag),
+      status_(kNeedMoreData),
+      consumed_(0),
+      field_(nullptr),
+      varint_(0),
+      shift_(0),
+      fixed_size_(0),
+      fixed_read_(0),
+      string_(nullptr),
+      remaining_(0),
+      packed_end_(SIZE_MAX) {
+    PushFrame(out, size);
+    if (size == 0) {
+        status_ = kDone;
+    }
+}
+
+void IncrementalDecoder::PushFrame(Message* message, size_t end) {
+    stack_.push_back(
+            Frame{message,
+                  message->GetReflection(),
+                  message->GetDescriptor(),
+                  end});
+}
+
+void IncrementalDecoder::SetError() {
+    status_ = kError;
+}
+
+IncrementalDecoder::Status IncrementalDecoder::Feed(
+        const uint8_t* data, size_t len) {
+    if (status_ != kNeedMoreData) {
+        return status_;
+    }
+
+    // Don't consume bytes after the end of a sized message.
+    size_t root_end = stack_.front().end;
+    if (root_end != SIZE_MAX) {
+        len = std::min(len, root_end - consumed_);
+    }
+
+    const uint8_t* end = data + len;
+    while (data < end) {
+        switch (state_) {
+            case kReadTag:
+            case kReadVarint:
+            case kReadLenSize: {
+                uint8_t b = *data++;
+                consumed_++;
+                if (shift_ >= 64) {
+                    cerr << "Varint is too long" << endl;
+                    SetError();
+                    return status_;
+                }
+                varint_ |= static_cast<uint64_t>(b & 0x7f) << shift_;
+                shift_ += 7;
+                if (b & 0x80) {
+                    break;
+                }
+                uint64_t value = varint_;
+                varint_ = 0;
+                shift_ = 0;
+                if (!OnVarint(value)) {
+                    SetError();
+                    return status_;
+                }
+                break;
+            }
+            case kReadFixed: {
+                size_t n = std::min<size_t>(
+                        fixed_size_ - fixed_read_, end - data);
+                std::copy(data, data + n, fixed_ + fixed_read_);
+                data += n;
+                consumed_ += n;
+                fixed_read_ += n;
+                if (fixed_read_ == fixed_size_ && !OnFixed()) {
+                    SetError();
+                    return status_;
+                }
+                break;
+            }
+            case kReadString:
+            case kSkipBytes: {
+                size_t n = std::min<size_t>(remaining_, end - data);
+                if (state_ == kReadString) {
+                    string_->append(reinterpret_cast<const char*>(data), n);
+                }
+                data += n;
+                consumed_ += n;
+                remaining_ -= n;
+                if (remaining_ == 0 && !EndField()) {
+                    SetError();
+                    return status_;
+                }
+                break;
+            }
+        }
+        if (status_ == kDone) {
+            break;
+        }
+    }
+    return status_;
+}
+
+IncrementalDecoder::Status IncrementalDecoder::Finish() {
+    if (status_ != kNeedMoreData) {
+        return status_;
+    }
+    // We must be at a field boundary of the top-level message.
+    if (state_ != kReadTag || shift_ != 0 || stack_.size() != 1 ||
+        stack_.front().end != SIZE_MAX) {
+        cerr << "The data ended in the middle of a message" << endl;
+        SetError();
+        return status_;
+    }
+    status_ = kDone;
+    return status_;
+}
+
+bool IncrementalDecoder::OnVarint(uint64_t value) {
+    switch (state_) {
+        case kReadTag:
+            return OnTag(value);
+        case kReadLenSize:
+            return OnLenSize(value);
+        case kReadVarint:
+            if (field_ != nullptr &&
+                !SetVarintField(
+                        stack_.back().message,
+                        stack_.back().reflection,
+                        field_,
+                        value)) {
+                return false;
+            }
+            return EndValue();
+        default:
+            return false;
+    }
+}
+
+bool IncrementalDecoder::OnTag(uint64_t tag) {
+    if (tag > UINT32_MAX) {
+        cerr << "Tag is too large: " << tag << endl;
+        return false;
+    }
+    uint32_t field_number = tag >> 3;
+    WireType wire_type = static_cast<WireType>(tag & 0x7);
+
+    field_ = stack_.back().descriptor->FindFieldByNumber(field_number);
+    if (field_ == nullptr) {
+        // TODO: We should keep them as unknown fields like DecodeMessage
+        // should do.
+        cerr << "Unknown field number: " << field_number << endl;
+    } else if (wire_type == kLen && IsPackable(*field_)) {
+        // A packed field, whose elements are read in OnLenSize().
+    } else if (GetWireType(field_->GetType()) != wire_type) {
+        cerr << "The wire type doesn't match the field type."
+             << " Field type: " << field_->GetType()
+             << ", Wire type: " << wire_type << endl;
+        return false;
+    }
+
+    switch (wire_type) {
+        case kVarint:
+        case kI64:
+        case kI32:
+            StartValue(wire_type);
+            return true;
+        case kLen:
+            state_ = kReadLenSize;
+            return true;
+        default:
+            cerr << "Unsupported wire type: " << wire_type << endl;
+            return false;
+    }
+}
+
+bool IncrementalDecoder::OnLenSize(uint64_t size) {
+    if (size > UINT32_MAX || size > stack_.back().end - consumed_) {
+        cerr << "Len-prefix field exceeds the message. size: " << size
+             << endl;
+        return false;
+    }
+
+    if (field_ == nullptr) {
+        state_ = kSkipBytes;
+        remaining_ = size;
+        return size > 0 || EndField();
+    }
+
+    if (IsPackable(*field_)) {
+        if (size == 0) {
+            return EndField();
+        }
+        packed_end_ = consumed_ + size;
+        StartValue(GetWireType(field_->GetType()));
+        return true;
+    }
+
+    const Frame& frame = stack_.back();
+    switch (field_->GetType()) {
+        case kString:
+            string_ = MutableStringField(
+                    frame.message, frame.reflection, field_);
+            string_->clear();
+            state_ = kReadString;
+            remaining_ = size;
+            return size > 0 || EndField();
+        case kMessage: {
+            Message* sub_message = MutableMessageField(
+                    frame.message, frame.reflection, field_);
+            PushFrame(sub_message, consumed_ + size);
+            // The sub message ends when its last field ends.
+            return EndField();
+        }
+        case kBytes:
+            cerr << "TODO: Decoding bytes field is not supported yet" << endl;
+            return false;
+        default:
+            cerr << "This field is not a len-prefix field. tag: "
+                 << field_->GetFieldNumber()
+                 << ", field type: " << field_->GetType() << endl;
+            return false;
+    }
+}
+
+bool IncrementalDecoder::OnFixed() {
+    if (field_ != nullptr) {
+        const Frame& frame = stack_.back();
+        uint64_t value = 0;
+        for (size_t i = 0; i < fixed_size_; i++) {
+            value |= static_cast<uint64_t>(fixed_[i]) << (8 * i);
+        }
+        bool result;
+        if (fixed_size_ == 4) {
+            result = SetFixedInt32Field(
+                    frame.message, frame.reflection, field_, value);
+        } else {
+            result = SetFixedInt64Field(
+                    frame.message, frame.reflection, field_, value);
+        }
+        if (!result) {
+            return false;
+        }
+    }
+    return EndValue();
+}
+
+void IncrementalDecoder::StartValue(WireType wire_type) {
+    switch (wire_type) {
+        case kI64:
+            state_ = kReadFixed;
+            fixed_size_ = 8;
+            fixed_read_ = 0;
+            break;
+        case kI32:
+            state_ = kReadFixed;
+            fixed_size_ = 4;
+            fixed_read_ = 0;
+            break;
+        default:
+            state_ = kReadVarint;
+            break;
+    }
+}
+
+bool IncrementalDecoder::EndValue() {
+    if (packed_end_ == SIZE_MAX) {
+        return EndField();
+    }
+    if (consumed_ < packed_end_) {
+        // The next element of the packed field follows.
+        StartValue(GetWireType(field_->GetType()));
+        return true;
+    }
+    if (consumed_ > packed_end_) {
+        cerr << "The last element exceeds the packed field" << endl;
+        return false;
+    }
+    return EndField();
+}
+
+bool IncrementalDecoder::EndField() {
+    state_ = kReadTag;
+    field_ = nullptr;
+    string_ = nullptr;
+    packed_end_ = SIZE_MAX;
+
+    // Close all messages which end here.
+    while (!stack_.empty() && stack_.back().end <= consumed_) {
+        if (stack_.back().end < consumed_) {
+            cerr << "The message size is not matched. Expected: "
+                 << stack_.back().end << ", Consumed: " << consumed_ << endl;
+            return false;
+        }
+        stack_.pop_back();
+    }
+    if (stack_.empty()) {
+        // The sized top-level message has been decoded.
+        status_ = kDone;
+    }
+    return true;
+}
+
+}  // namespace decaproto
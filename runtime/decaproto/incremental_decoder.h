@@ -0,0 +1,134 @@
+#ifndef DECAPROTO_INCREMENTAL_DECODER_H
+#define DECAPROTO_INCREMENTAL_DECODER_H
+
+#include <string>
+#include <vector>
+
+#include "decaproto/descriptor.h"
+#include "decaproto/message.h"
+#include "decaproto/reflection.h"
+#include "decaproto/stream/coded_stream.h"
+
+namespace decaproto {
+
+// Push-style decoder for transports which deliver a message in fragments
+// (e.g. UART or non-blocking sockets).
+//
+// Unlike DecodeMessage(), which fails once the stream runs dry, it keeps the
+// parse state (nested messages, a partially read varint, fixed value or
+// string) between Feed() calls, so the caller can pass data as it arrives
+// without buffering a whole message. Each byte is processed exactly once no
+// matter how the data is fragmented.
+//
+//   MyMessage msg;
+//   IncrementalDecoder decoder(&msg);
+//   while (...) {
+//       size_t len = uart.Read(buf, sizeof(buf));
+//       if (decoder.Feed(buf, len) == IncrementalDecoder::kError) {
+//           ...
+//       }
+//   }
+//   if (decoder.Finish() == IncrementalDecoder::kDone) {
+//       // msg is ready
+//   }
+class IncrementalDecoder {
+public:
+    enum Status {
+        // The message isn't complete yet.
+        kNeedMoreData,
+        // The message has been decoded.
+        kDone,
+        // The data is broken. Following calls keep returning kError.
+        kError,
+    };
+
+    // Decodes into `out` until Finish() is called.
+    IncrementalDecoder(Message* out);
+
+    // Decodes a message of exactly `size` bytes into `out`.
+    // Feed() returns kDone once `size` bytes have been fed, and leaves bytes
+    // after them unconsumed (see ConsumedSize()).
+    IncrementalDecoder(Message* out, size_t size);
+
+    // Decodes `len` bytes starting from `data`.
+    Status Feed(const uint8_t* data, size_t len);
+
+    // Tells the decoder that no more data will be fed.
+    // Returns kDone if the data ended at a field boundary of the top-level
+    // message, kError otherwise.
+    Status Finish();
+
+    Status GetStatus() const {
+        return status_;
+    }
+
+    // How many bytes have been consumed by Feed().
+    size_t ConsumedSize() const {
+        return consumed_;
+    }
+
+private:
+    // What we are reading now.
+    enum State {
+        kReadTag,
+        kReadVarint,
+        kReadFixed,
+        kReadLenSize,
+        kReadString,
+        kSkipBytes,
+    };
+
+    // A message being decoded, which ends at `end` bytes from the beginning
+    // of the data.
+    struct Frame {
+        Message* message;
+        const Reflection* reflection;
+        const Descriptor* descriptor;
+        size_t end;
+    };
+
+    void PushFrame(Message* message, size_t end);
+    bool OnVarint(uint64_t value);
+    bool OnTag(uint64_t tag);
+    bool OnLenSize(uint64_t size);
+    bool OnFixed();
+    // Starts reading a varint or fixed value of `wire_type`.
+    void StartValue(WireType wire_type);
+    // Called when a value has been read. Moves on to the next element of a
+    // packed field, or ends the field.
+    bool EndValue();
+    // Called when a field has been read completely.
+    bool EndField();
+    void SetError();
+
+    std::vector<Frame> stack_;
+    State state_;
+    Status status_;
+    size_t consumed_;
+
+    // The field being read. nullptr if we are skipping an unknown field.
+    const FieldDescriptor* field_;
+
+    // Partial varint
+    uint64_t varint_;
+    int shift_;
+
+    // Partial fixed value
+    uint8_t fixed_[8];
+    size_t fixed_size_;
+    size_t fixed_read_;
+
+    // Partial string
+    std::string* string_;
+
+    // Bytes left in the string or the unknown field being skipped
+    size_t remaining_;
+
+    // End of the packed field being read in ConsumedSize(), or SIZE_MAX if
+    // we aren't in a packed field.
+    size_t packed_end_;
+};
+
+}  // namespace decaproto
+
+#endif  // DECAPROTO_INCREMENTAL_DECODER_H
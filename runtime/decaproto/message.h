@@ -7,6 +7,7 @@
 #include "decaproto/reflection.h"
 #include "decaproto/stream/coded_stream.h"
 #include "decaproto/stream/stream.h"
+#include "decaproto/stream/zero_copy_stream.h"
 
 namespace decaproto {
 
@@ -23,10 +24,35 @@ public:
         CodedOutputStream cos(&stream);
         bool result = this->EncodeImpl(cos);
         written_size = cos.WrittenSize();
-        return result;
+        return result && !cos.HadError();
     }
 
+    bool Encode(ZeroCopyOutputStream& stream, size_t& written_size) const {
+        CodedOutputStream cos(&stream);
+        bool result = this->EncodeImpl(cos);
+        written_size = cos.WrittenSize();
+        return result && !cos.HadError();
+    }
+
+    // Resets all fields to their default values.
+    // Generated messages override it. The default implementation does
+    // nothing so that hand-written subclasses keep compiling, but they should
+    // override it as well to be reused with DelimitedReader.
+    virtual void Clear() {
+    }
+
+    // Writes the fields to `stream`. Implementations may ignore the result of
+    // each write; a failed write is reported by stream.HadError().
     virtual bool EncodeImpl(CodedOutputStream& stream) const = 0;
+
+    // Decodes fields from `stream` into this message until the current limit
+    // of `stream`, or until its end if no limit is pushed. Use
+    // DecodeMessage() in decoder.h instead of calling it directly.
+    //
+    // Generated messages override it with a decoder which stores the fields
+    // directly. The default implementation goes through GetReflection() and
+    // GetDescriptor().
+    virtual bool DecodeImpl(CodedInputStream& stream);
     virtual size_t ComputeEncodedSize() const = 0;
 
     virtual const Descriptor* GetDescriptor() const = 0;
@@ -6,7 +6,9 @@
 #include <iostream>
 #include <map>
 #include <string>
+#include <string_view>
 #include <type_traits>
+#include <vector>
 
 #include "decaproto/descriptor.h"
 
@@ -68,6 +70,8 @@ private:                                                                       \
     std::map<uint32_t, SetRepeatedFn<cc_type>> set_repeated_##CcType##_impls_; \
     std::map<uint32_t, GetRepeatedFn<cc_type>> get_repeated_##CcType##_impls_; \
     std::map<uint32_t, AddRepeatedFn<cc_type>> add_repeated_##CcType##_impls_; \
+    std::map<uint32_t, MutableFn<std::vector<cc_type>*>>                       \
+            mutable_repeated_##CcType##_impls_;                                \
                                                                                \
 public:                                                                        \
     void RegisterSet##CcType(uint32_t tag, const SetterFn<cc_type>& setter) {  \
@@ -123,6 +127,24 @@ public:                                                                        \
     void RegisterAddRepeated##CcType(                                          \
             uint32_t tag, const AddRepeatedFn<cc_type>& adder) {               \
         add_repeated_##CcType##_impls_[tag] = adder;                           \
+    }                                                                          \
+                                                                               \
+    /* Returns the vector which holds repeated field `tag` so that many     */ \
+    /* values can be added at once, or nullptr if the message doesn't       */ \
+    /* expose it. Use AddRepeated*() in that case.                          */ \
+    std::vector<cc_type>* MutableRepeated##CcType##Field(                      \
+            Message* message, uint32_t tag) const {                            \
+        auto it = mutable_repeated_##CcType##_impls_.find(tag);                \
+        if (it == mutable_repeated_##CcType##_impls_.end()) {                  \
+            return nullptr;                                                    \
+        }                                                                      \
+        return it->second(message);                                            \
+    }                                                                          \
+                                                                               \
+    void RegisterMutableRepeated##CcType##Field(                               \
+            uint32_t tag,                                                      \
+            const MutableFn<std::vector<cc_type>*>& mut_getter) {              \
+        mutable_repeated_##CcType##_impls_[tag] = mut_getter;                  \
     }
 
     DEFINE_FOR(uint64_t, Uint64)
@@ -223,6 +245,47 @@ public:                                                                        \
 
 #undef DEFINE_FOR
 
+private:
+    // For string fields which can refer to the input buffer
+    std::map<uint32_t, SetterFn<std::string_view>> set_string_view_impls_;
+    std::map<uint32_t, GetterFn<std::string_view>> get_string_view_impls_;
+
+public:
+    // Makes string field `tag` refer to `value` without copying it.
+    // Returns false if the message doesn't support it for the field (e.g.
+    // repeated fields). The caller should store a copy instead.
+    bool SetStringView(
+            Message* message, uint32_t tag, std::string_view value) const {
+        auto it = set_string_view_impls_.find(tag);
+        if (it == set_string_view_impls_.end()) {
+            return false;
+        }
+        it->second(message, value);
+        return true;
+    }
+
+    void RegisterSetStringView(
+            uint32_t tag, const SetterFn<std::string_view>& setter) {
+        set_string_view_impls_[tag] = setter;
+    }
+
+    // Reads string field `tag` whether or not it refers to the input buffer.
+    // Prefer it to GetString(), which fails on such fields of generated
+    // messages. Falls back to GetString() if the message doesn't register
+    // a view getter for the field.
+    std::string_view GetStringView(const Message* message, uint32_t tag) const {
+        auto it = get_string_view_impls_.find(tag);
+        if (it == get_string_view_impls_.end()) {
+            return GetString(message, tag);
+        }
+        return it->second(message);
+    }
+
+    void RegisterGetStringView(
+            uint32_t tag, const GetterFn<std::string_view>& getter) {
+        get_string_view_impls_[tag] = getter;
+    }
+
 private:
     // For fields which we shouldn't copy
     // We provide a mutable getter and getter which returns a reference
@@ -0,0 +1,132 @@
+#ifndef DECAPROTO_STREAM_ARRAY_STREAM_H
+#define DECAPROTO_STREAM_ARRAY_STREAM_H
+
+#include <cstring>
+#include <string>
+
+#include "decaproto/stream/stream.h"
+
+namespace decaproto {
+
+// InputStream which reads from a contiguous buffer (e.g. a recv buffer or
+// std::string).
+// The buffer must outlive the stream.
+//
+// CodedInputStream reads the buffer directly through GetDirectBuffer() so that
+// decoding from an ArrayInputStream doesn't involve any virtual calls per byte.
+class ArrayInputStream : public InputStream {
+    const uint8_t* data_;
+    size_t size_;
+    size_t position_;
+
+public:
+    ArrayInputStream(const uint8_t* data, size_t size)
+        : data_(data), size_(size), position_(0) {
+    }
+
+    ArrayInputStream(const std::string& str)
+        : data_(reinterpret_cast<const uint8_t*>(str.data())),
+          size_(str.size()),
+          position_(0) {
+    }
+
+    virtual ~ArrayInputStream() {
+    }
+
+    bool Read(uint8_t& out) override {
+        if (position_ >= size_) {
+            return false;
+        }
+        out = data_[position_++];
+        return true;
+    }
+
+    bool ReadBytes(uint8_t* out, size_t len) override {
+        if (len > size_ - position_) {
+            return false;
+        }
+        std::memcpy(out, data_ + position_, len);
+        position_ += len;
+        return true;
+    }
+
+    bool Skip(size_t len) override {
+        if (len > size_ - position_) {
+            position_ = size_;
+            return false;
+        }
+        position_ += len;
+        return true;
+    }
+
+    bool GetDirectBuffer(const uint8_t*& data, size_t& size) override {
+        data = data_ + position_;
+        size = size_ - position_;
+        return true;
+    }
+
+    void ConsumeDirectBuffer(size_t len) override {
+        position_ += len;
+    }
+
+    // How many bytes have been read from the buffer.
+    size_t Position() const {
+        return position_;
+    }
+};
+
+// OutputStream which writes into a fixed-size buffer.
+// Writes fail once the buffer is full.
+//
+// CodedOutputStream writes into the buffer directly through GetDirectBuffer()
+// so that encoding into an ArrayOutputStream doesn't involve any virtual calls
+// per byte.
+class ArrayOutputStream : public OutputStream {
+    uint8_t* data_;
+    size_t size_;
+    size_t position_;
+
+public:
+    ArrayOutputStream(uint8_t* data, size_t size)
+        : data_(data), size_(size), position_(0) {
+    }
+
+    virtual ~ArrayOutputStream() {
+    }
+
+    bool Write(uint8_t ch) override {
+        if (position_ >= size_) {
+            return false;
+        }
+        data_[position_++] = ch;
+        return true;
+    }
+
+    bool WriteBytes(const uint8_t* data, size_t len) override {
+        if (len > size_ - position_) {
+            return false;
+        }
+        std::memcpy(data_ + position_, data, len);
+        position_ += len;
+        return true;
+    }
+
+    bool GetDirectBuffer(uint8_t*& data, size_t& size) override {
+        data = data_ + position_;
+        size = size_ - position_;
+        return true;
+    }
+
+    void CommitDirectBuffer(size_t len) override {
+        position_ += len;
+    }
+
+    // How many bytes have been written into the buffer.
+    size_t WrittenSize() const {
+        return position_;
+    }
+};
+
+}  // namespace decaproto
+
+#endif  // DECAPROTO_STREAM_ARRAY_STREAM_H
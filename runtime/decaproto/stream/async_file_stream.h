@@ -0,0 +1,584 @@
+#ifndef DECAPROTO_STREAM_ASYNC_FILE_STREAM_H
+#define DECAPROTO_STREAM_ASYNC_FILE_STREAM_H
+
+// POSIX only (io_uring is used only on Linux). This header isn't included by
+// the rest of the runtime so that the library still builds on platforms
+// without threads or file descriptors (e.g. Arduino).
+
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+#include "decaproto/stream/zero_copy_stream.h"
+
+namespace decaproto {
+
+// ZeroCopyOutputStream which writes into a regular file asynchronously.
+//
+// CodedOutputStream encodes messages directly into a set of fixed buffers.
+// Messages are packed into the current buffer until it's full, even across
+// CodedOutputStream objects (the unused tail given back by BackUp() is
+// handed out again by the next Next() call). Once a buffer is filled, it's
+// handed to io_uring (or to a pool of threads
+// calling pwrite(2) if io_uring isn't available) and CodedOutputStream moves
+// on to the next free buffer, so the producer only waits for the disk when
+// all of the buffers are in flight.
+//
+//   AsyncFileOutputStream stream(fd);
+//   for (...) {
+//       size_t size;
+//       msg.Encode(stream, size);
+//   }
+//   stream.Flush();
+//
+// Data is written from the current offset of `fd` with pwrite semantics, so
+// `fd` must be seekable. The file descriptor isn't closed by the stream.
+class AsyncFileOutputStream : public ZeroCopyOutputStream {
+public:
+    enum Backend {
+        // io_uring if the kernel supports it, the thread pool otherwise
+        kAuto,
+        kIoUring,
+        kThreadPool,
+    };
+
+    // `max_in_flight` buffers of `buffer_size` bytes each are allocated.
+    AsyncFileOutputStream(
+            int fd,
+            size_t buffer_size = 65536,
+            size_t max_in_flight = 8,
+            Backend backend = kAuto)
+        : buffer_size_(buffer_size),
+          buffers_(new uint8_t[buffer_size * max_in_flight]),
+          current_(kNoBuffer),
+          current_used_(0),
+          in_flight_(0),
+          submit_count_(0),
+          byte_count_(0),
+          had_error_(false) {
+        off_t offset = lseek(fd, 0, SEEK_CUR);
+        offset_ = offset < 0 ? 0 : offset;
+        for (size_t i = 0; i < max_in_flight; i++) {
+            free_.push_back(max_in_flight - 1 - i);
+        }
+
+#ifdef __linux__
+        if (backend != kThreadPool) {
+            std::unique_ptr<IoUringWriter> writer(new IoUringWriter());
+            if (writer->Init(
+                        fd, buffers_.get(), buffer_size, max_in_flight)) {
+                writer_ = std::move(writer);
+            }
+        }
+#endif
+        if (!writer_ && backend != kIoUring) {
+            writer_.reset(new ThreadPoolWriter(fd, max_in_flight));
+        }
+        if (!writer_) {
+            // io_uring was requested explicitly but isn't available.
+            had_error_ = true;
+        }
+    }
+
+    virtual ~AsyncFileOutputStream() {
+        Flush();
+    }
+
+    AsyncFileOutputStream(const AsyncFileOutputStream&) = delete;
+    AsyncFileOutputStream& operator=(const AsyncFileOutputStream&) = delete;
+
+    bool Next(void** data, int* size) override {
+        if (had_error_) {
+            return false;
+        }
+        if (current_ != kNoBuffer && current_used_ < buffer_size_) {
+            // Hand out the rest of the current buffer instead of submitting
+            // it half empty.
+            size_t rest = buffer_size_ - current_used_;
+            *data = BufferAt(current_) + current_used_;
+            *size = static_cast<int>(rest);
+            current_used_ = buffer_size_;
+            byte_count_ += rest;
+            return true;
+        }
+        SubmitCurrent();
+        while (free_.empty()) {
+            if (!WaitOne()) {
+                return false;
+            }
+        }
+        if (had_error_) {
+            return false;
+        }
+        current_ = free_.back();
+        free_.pop_back();
+        current_used_ = buffer_size_;
+        byte_count_ += buffer_size_;
+        *data = BufferAt(current_);
+        *size = static_cast<int>(buffer_size_);
+        return true;
+    }
+
+    void BackUp(int count) override {
+        current_used_ -= count;
+        byte_count_ -= count;
+    }
+
+    int64_t ByteCount() const override {
+        return byte_count_;
+    }
+
+    // Submits the partially filled buffer and waits until all of the
+    // submitted data is written or has failed.
+    // Returns false if any write has failed.
+    //
+    // Don't call it while a CodedOutputStream writing into this stream is
+    // alive since it still owns the current buffer.
+    bool Flush() {
+        SubmitCurrent();
+        // Keep waiting after a failed write since the other buffers are
+        // still in flight.
+        while (in_flight_ > 0) {
+            if (!WaitOne()) {
+                break;
+            }
+        }
+        return !had_error_;
+    }
+
+    bool HadError() const {
+        return had_error_;
+    }
+
+    // Number of buffers submitted to be written so far.
+    size_t SubmitCount() const {
+        return submit_count_;
+    }
+
+    // Number of buffers submitted but not written yet.
+    size_t InFlightCount() const {
+        return in_flight_;
+    }
+
+    // True if the writes are submitted through io_uring.
+    bool UsesIoUring() const {
+        return writer_ && writer_->IsIoUring();
+    }
+
+private:
+    static constexpr size_t kNoBuffer = SIZE_MAX;
+
+    // A write request of a whole buffer or the rest of it.
+    struct Request {
+        size_t index;
+        const uint8_t* data;
+        size_t len;
+        off_t offset;
+    };
+
+    // Executes write requests asynchronously.
+    class Writer {
+    public:
+        virtual ~Writer() {
+        }
+        virtual bool IsIoUring() const = 0;
+        virtual bool Submit(const Request& request) = 0;
+        // Waits until a buffer is written completely and returns its index.
+        // `ok` is set to false if the write failed.
+        virtual bool Wait(size_t& index, bool& ok) = 0;
+    };
+
+    // Calls pwrite(2) on worker threads.
+    class ThreadPoolWriter : public Writer {
+        int fd_;
+        std::mutex mutex_;
+        std::condition_variable request_cv_;
+        std::condition_variable done_cv_;
+        std::deque<Request> requests_;
+        std::deque<std::pair<size_t, bool>> done_;
+        bool closing_;
+        std::vector<std::thread> threads_;
+
+        static bool WriteFully(int fd, Request request) {
+            while (request.len > 0) {
+                ssize_t result = pwrite(
+                        fd, request.data, request.len, request.offset);
+                if (result < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (result <= 0) {
+                    return false;
+                }
+                request.data += result;
+                request.len -= result;
+                request.offset += result;
+            }
+            return true;
+        }
+
+        void Run() {
+            std::unique_lock<std::mutex> lock(mutex_);
+            while (true) {
+                request_cv_.wait(lock, [this] {
+                    return closing_ || !requests_.empty();
+                });
+                if (requests_.empty()) {
+                    return;
+                }
+                Request request = requests_.front();
+                requests_.pop_front();
+
+                lock.unlock();
+                bool ok = WriteFully(fd_, request);
+                lock.lock();
+
+                done_.push_back(std::make_pair(request.index, ok));
+                done_cv_.notify_one();
+            }
+        }
+
+    public:
+        ThreadPoolWriter(int fd, size_t thread_count)
+            : fd_(fd), closing_(false) {
+            for (size_t i = 0; i < thread_count; i++) {
+                threads_.push_back(std::thread([this] { Run(); }));
+            }
+        }
+
+        virtual ~ThreadPoolWriter() {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                closing_ = true;
+            }
+            request_cv_.notify_all();
+            for (std::thread& thread : threads_) {
+                thread.join();
+            }
+        }
+
+        bool IsIoUring() const override {
+            return false;
+        }
+
+        bool Submit(const Request& request) override {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                requests_.push_back(request);
+            }
+            request_cv_.notify_one();
+            return true;
+        }
+
+        bool Wait(size_t& index, bool& ok) override {
+            std::unique_lock<std::mutex> lock(mutex_);
+            done_cv_.wait(lock, [this] { return !done_.empty(); });
+            index = done_.front().first;
+            ok = done_.front().second;
+            done_.pop_front();
+            return true;
+        }
+    };
+
+#ifdef __linux__
+    // Submits IORING_OP_WRITE_FIXED requests on the buffers registered to
+    // the ring. Talks to the kernel through raw syscalls so that liburing
+    // isn't required.
+    class IoUringWriter : public Writer {
+        int ring_fd_;
+        int fd_;
+
+        void* sq_ring_;
+        size_t sq_ring_size_;
+        void* cq_ring_;
+        size_t cq_ring_size_;
+        io_uring_sqe* sqes_;
+        size_t sqes_size_;
+
+        // We never have more requests than the entries of the ring, so the
+        // head of the submission queue doesn't need to be checked.
+        unsigned* sq_tail_;
+        unsigned* sq_mask_;
+        unsigned* sq_array_;
+        unsigned* cq_head_;
+        unsigned* cq_tail_;
+        unsigned* cq_mask_;
+        io_uring_cqe* cqes_;
+
+        // The part of each buffer which hasn't been written yet.
+        std::vector<Request> pending_;
+
+        template <typename T>
+        static T* At(void* base, size_t offset) {
+            return reinterpret_cast<T*>(static_cast<uint8_t*>(base) + offset);
+        }
+
+        int Enter(unsigned to_submit, unsigned min_complete, unsigned flags) {
+            int result;
+            do {
+                result = syscall(
+                        __NR_io_uring_enter,
+                        ring_fd_,
+                        to_submit,
+                        min_complete,
+                        flags,
+                        nullptr,
+                        0);
+            } while (result < 0 && errno == EINTR);
+            return result;
+        }
+
+        bool Push(const Request& request) {
+            unsigned tail = *sq_tail_;
+            unsigned slot = tail & *sq_mask_;
+            io_uring_sqe* sqe = &sqes_[slot];
+            std::memset(sqe, 0, sizeof(*sqe));
+            sqe->opcode = IORING_OP_WRITE_FIXED;
+            sqe->fd = fd_;
+            sqe->addr = reinterpret_cast<uint64_t>(request.data);
+            sqe->len = static_cast<uint32_t>(request.len);
+            sqe->off = request.offset;
+            sqe->buf_index = static_cast<uint16_t>(request.index);
+            sqe->user_data = request.index;
+            sq_array_[slot] = slot;
+            // Publish the entry before moving the tail.
+            __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+            return Enter(1, 0, 0) >= 0;
+        }
+
+    public:
+        IoUringWriter()
+            : ring_fd_(-1),
+              fd_(-1),
+              sq_ring_(MAP_FAILED),
+              sq_ring_size_(0),
+              cq_ring_(MAP_FAILED),
+              cq_ring_size_(0),
+              sqes_(static_cast<io_uring_sqe*>(MAP_FAILED)),
+              sqes_size_(0) {
+        }
+
+        virtual ~IoUringWriter() {
+            if (sqes_ != MAP_FAILED) {
+                munmap(sqes_, sqes_size_);
+            }
+            if (cq_ring_ != MAP_FAILED && cq_ring_ != sq_ring_) {
+                munmap(cq_ring_, cq_ring_size_);
+            }
+            if (sq_ring_ != MAP_FAILED) {
+                munmap(sq_ring_, sq_ring_size_);
+            }
+            if (ring_fd_ >= 0) {
+                close(ring_fd_);
+            }
+        }
+
+        // Returns false if io_uring isn't available.
+        bool Init(int fd, uint8_t* buffers, size_t buffer_size, size_t count) {
+            fd_ = fd;
+            pending_.resize(count);
+
+            io_uring_params params;
+            std::memset(&params, 0, sizeof(params));
+            ring_fd_ = syscall(__NR_io_uring_setup, count, &params);
+            if (ring_fd_ < 0) {
+                return false;
+            }
+
+            sq_ring_size_ =
+                    params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            cq_ring_size_ = params.cq_off.cqes +
+                            params.cq_entries * sizeof(io_uring_cqe);
+            bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+            if (single_mmap && cq_ring_size_ > sq_ring_size_) {
+                sq_ring_size_ = cq_ring_size_;
+            }
+            sq_ring_ =
+                    mmap(nullptr,
+                         sq_ring_size_,
+                         PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE,
+                         ring_fd_,
+                         IORING_OFF_SQ_RING);
+            if (sq_ring_ == MAP_FAILED) {
+                return false;
+            }
+            if (single_mmap) {
+                cq_ring_ = sq_ring_;
+            } else {
+                cq_ring_ =
+                        mmap(nullptr,
+                             cq_ring_size_,
+                             PROT_READ | PROT_WRITE,
+                             MAP_SHARED | MAP_POPULATE,
+                             ring_fd_,
+                             IORING_OFF_CQ_RING);
+                if (cq_ring_ == MAP_FAILED) {
+                    return false;
+                }
+            }
+            sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+            sqes_ = static_cast<io_uring_sqe*>(
+                    mmap(nullptr,
+                         sqes_size_,
+                         PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE,
+                         ring_fd_,
+                         IORING_OFF_SQES));
+            if (sqes_ == MAP_FAILED) {
+                return false;
+            }
+
+            sq_tail_ = At<unsigned>(sq_ring_, params.sq_off.tail);
+            sq_mask_ = At<unsigned>(sq_ring_, params.sq_off.ring_mask);
+            sq_array_ = At<unsigned>(sq_ring_, params.sq_off.array);
+            cq_head_ = At<unsigned>(cq_ring_, params.cq_off.head);
+            cq_tail_ = At<unsigned>(cq_ring_, params.cq_off.tail);
+            cq_mask_ = At<unsigned>(cq_ring_, params.cq_off.ring_mask);
+            cqes_ = At<io_uring_cqe>(cq_ring_, params.cq_off.cqes);
+
+            // Register the buffers so that the kernel doesn't need to map
+            // them for each request.
+            std::vector<iovec> iovs(count);
+            for (size_t i = 0; i < count; i++) {
+                iovs[i].iov_base = buffers + buffer_size * i;
+                iovs[i].iov_len = buffer_size;
+            }
+            return syscall(__NR_io_uring_register,
+                           ring_fd_,
+                           IORING_REGISTER_BUFFERS,
+                           iovs.data(),
+                           count) == 0;
+        }
+
+        bool IsIoUring() const override {
+            return true;
+        }
+
+        bool Submit(const Request& request) override {
+            pending_[request.index] = request;
+            return Push(request);
+        }
+
+        bool Wait(size_t& index, bool& ok) override {
+            while (true) {
+                unsigned head = *cq_head_;
+                if (head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+                    if (Enter(0, 1, IORING_ENTER_GETEVENTS) < 0) {
+                        return false;
+                    }
+                    continue;
+                }
+                io_uring_cqe* cqe = &cqes_[head & *cq_mask_];
+                index = cqe->user_data;
+                int result = cqe->res;
+                __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+
+                Request& request = pending_[index];
+                if (result == -EINTR || result == -EAGAIN) {
+                    // Retry the same request.
+                    if (!Push(request)) {
+                        return false;
+                    }
+                    continue;
+                }
+                if (result <= 0) {
+                    ok = false;
+                    return true;
+                }
+                request.data += result;
+                request.len -= result;
+                request.offset += result;
+                if (request.len > 0) {
+                    // Short write. Submit the rest.
+                    if (!Push(request)) {
+                        return false;
+                    }
+                    continue;
+                }
+                ok = true;
+                return true;
+            }
+        }
+    };
+#endif  // __linux__
+
+    uint8_t* BufferAt(size_t index) {
+        return buffers_.get() + buffer_size_ * index;
+    }
+
+    void SubmitCurrent() {
+        if (current_ == kNoBuffer) {
+            return;
+        }
+        size_t index = current_;
+        current_ = kNoBuffer;
+        if (current_used_ == 0 || had_error_) {
+            free_.push_back(index);
+            return;
+        }
+        Request request{index, BufferAt(index), current_used_, offset_};
+        offset_ += current_used_;
+        if (!writer_->Submit(request)) {
+            had_error_ = true;
+            free_.push_back(index);
+            return;
+        }
+        in_flight_++;
+        submit_count_++;
+    }
+
+    // Waits until one of the in-flight buffers is written or has failed.
+    // A failed write is recorded in had_error_. Returns false only if it
+    // couldn't wait for the buffer.
+    bool WaitOne() {
+        if (in_flight_ == 0) {
+            return false;
+        }
+        size_t index;
+        bool ok;
+        if (!writer_->Wait(index, ok)) {
+            had_error_ = true;
+            return false;
+        }
+        in_flight_--;
+        free_.push_back(index);
+        if (!ok) {
+            had_error_ = true;
+        }
+        return true;
+    }
+
+    size_t buffer_size_;
+    std::unique_ptr<uint8_t[]> buffers_;
+    // Indices of the buffers which are neither in flight nor being filled.
+    std::vector<size_t> free_;
+    // The buffer being filled and how much of it is used.
+    size_t current_;
+    size_t current_used_;
+    size_t in_flight_;
+    size_t submit_count_;
+    // The file offset to write the next buffer at.
+    off_t offset_;
+    int64_t byte_count_;
+    bool had_error_;
+    std::unique_ptr<Writer> writer_;
+};
+
+}  // namespace decaproto
+
+#endif  // DECAPROTO_STREAM_ASYNC_FILE_STREAM_H
@@ -1,14 +1,280 @@
 #include "decaproto/stream/coded_stream.h"
 
+#include <algorithm>
 #include <iostream>
 
+#include "decaproto/stream/varint_batch.h"
+
 namespace decaproto {
 
-bool CodedInputStream::ReadVarint64(uint64_t& result) {
+namespace {
+
+// ReadString and ReadVarintArray grow the buffer by this size at most at once
+// so that a broken length prefix doesn't make us allocate a huge buffer before
+// we notice the end of the stream.
+const size_t kReadStringChunkSize = 4096;
+
+// Decodes a varint starting from `p` without checking the end of the buffer.
+// Returns the pointer next to the varint, or nullptr if the varint is longer
+// than 10 bytes.
+//
+// Each byte is added with its continuation bit, which is subtracted afterwards
+// only if the varint continues, so that every step is just a load, an add and
+// a branch.
+inline const uint8_t* DecodeVarint64Unrolled(
+        const uint8_t* p, uint64_t& result) {
+    uint64_t b;
+    uint64_t r;
+
+    b = *p++;
+    r = b;
+    if (b < 0x80) {
+        result = r;
+        return p;
+    }
+    r -= 0x80;
+
+    b = *p++;
+    r += b << 7;
+    if (b < 0x80) {
+        result = r;
+        return p;
+    }
+    r -= 0x80ULL << 7;
+
+    b = *p++;
+    r += b << 14;
+    if (b < 0x80) {
+        result = r;
+        return p;
+    }
+    r -= 0x80ULL << 14;
+
+    b = *p++;
+    r += b << 21;
+    if (b < 0x80) {
+        result = r;
+        return p;
+    }
+    r -= 0x80ULL << 21;
+
+    b = *p++;
+    r += b << 28;
+    if (b < 0x80) {
+        result = r;
+        return p;
+    }
+    r -= 0x80ULL << 28;
+
+    b = *p++;
+    r += b << 35;
+    if (b < 0x80) {
+        result = r;
+        return p;
+    }
+    r -= 0x80ULL << 35;
+
+    b = *p++;
+    r += b << 42;
+    if (b < 0x80) {
+        result = r;
+        return p;
+    }
+    r -= 0x80ULL << 42;
+
+    b = *p++;
+    r += b << 49;
+    if (b < 0x80) {
+        result = r;
+        return p;
+    }
+    r -= 0x80ULL << 49;
+
+    b = *p++;
+    r += b << 56;
+    if (b < 0x80) {
+        result = r;
+        return p;
+    }
+    r -= 0x80ULL << 56;
+
+    // Only the lowest bit of the 10th byte fits in 64 bits.
+    b = *p++;
+    r += b << 63;
+    if (b < 0x80) {
+        result = r;
+        return p;
+    }
+    return nullptr;
+}
+
+}  // namespace
+
+bool CodedInputStream::Refresh() {
+    if (zero_copy_ == nullptr || BytesUntilLimit() == 0) {
+        return false;
+    }
+    chunks_consumed_ += ptr_ - buffer_start_;
+    buffer_start_ = ptr_ = buffer_end_;
+
+    const void* data;
+    int size;
+    do {
+        if (!zero_copy_->Next(&data, &size)) {
+            return false;
+        }
+    } while (size <= 0);
+
+    buffer_start_ = static_cast<const uint8_t*>(data);
+    ptr_ = buffer_start_;
+    buffer_end_ = buffer_start_ + size;
+    UpdateLimit();
+    return true;
+}
+
+void CodedInputStream::UpdateLimit() {
+    limit_ = buffer_end_;
+    size_t remaining = BytesUntilLimit();
+    if (remaining < static_cast<size_t>(buffer_end_ - ptr_)) {
+        limit_ = ptr_ + remaining;
+    }
+}
+
+bool CodedInputStream::PushLimit(size_t size) {
+    size_t remaining = BytesUntilLimit();
+    if (size > remaining) {
+        return false;
+    }
+    limit_stack_.push_back(current_limit_);
+    current_limit_ = ConsumedSize() + size;
+    UpdateLimit();
+    return true;
+}
+
+void CodedInputStream::PopLimit() {
+    current_limit_ = limit_stack_.back();
+    limit_stack_.pop_back();
+    UpdateLimit();
+}
+
+bool CodedInputStream::ReadByteSlow(uint8_t& out) {
+    if (!direct_) {
+        if (BytesUntilLimit() == 0) {
+            return false;
+        }
+        return input_.Read(out);
+    }
+    if (!Refresh()) {
+        return false;
+    }
+    out = *ptr_++;
+    return true;
+}
+
+bool CodedInputStream::ReadRaw(uint8_t* out, size_t len) {
+    if (!direct_) {
+        if (len > BytesUntilLimit()) {
+            return false;
+        }
+        return input_.ReadBytes(out, len);
+    }
+    if (zero_copy_ == nullptr && len > static_cast<size_t>(limit_ - ptr_)) {
+        return false;
+    }
+
+    while (len > static_cast<size_t>(limit_ - ptr_)) {
+        size_t available = limit_ - ptr_;
+        std::copy(ptr_, limit_, out);
+        ptr_ += available;
+        out += available;
+        len -= available;
+        if (!Refresh()) {
+            return false;
+        }
+    }
+    std::copy(ptr_, ptr_ + len, out);
+    ptr_ += len;
+    return true;
+}
+
+bool CodedInputStream::Skip(size_t len) {
+    if (!direct_) {
+        if (len > BytesUntilLimit()) {
+            return false;
+        }
+        return input_.Skip(len);
+    }
+    while (len > static_cast<size_t>(limit_ - ptr_)) {
+        len -= limit_ - ptr_;
+        ptr_ = limit_;
+        if (!Refresh()) {
+            return false;
+        }
+    }
+    ptr_ += len;
+    return true;
+}
+
+bool CodedInputStream::ReadString(std::string& result, size_t len) {
+    if (direct_) {
+        if (len <= static_cast<size_t>(limit_ - ptr_)) {
+            result.assign(reinterpret_cast<const char*>(ptr_), len);
+            ptr_ += len;
+            return true;
+        }
+
+        // The string spans multiple chunks.
+        // Append them one by one so that the string grows only as much as the
+        // data we actually have.
+        result.clear();
+        while (len > static_cast<size_t>(limit_ - ptr_)) {
+            size_t available = limit_ - ptr_;
+            result.append(reinterpret_cast<const char*>(ptr_), available);
+            ptr_ += available;
+            len -= available;
+            if (!Refresh()) {
+                return false;
+            }
+        }
+        result.append(reinterpret_cast<const char*>(ptr_), len);
+        ptr_ += len;
+        return true;
+    }
+
+    result.clear();
+    if (len > BytesUntilLimit()) {
+        return false;
+    }
+    size_t read_size = 0;
+    while (read_size < len) {
+        size_t chunk_size = std::min(len - read_size, kReadStringChunkSize);
+        result.resize(read_size + chunk_size);
+        if (!input_.ReadBytes(
+                    reinterpret_cast<uint8_t*>(&result[read_size]),
+                    chunk_size)) {
+            return false;
+        }
+        read_size += chunk_size;
+    }
+    return true;
+}
+
+bool CodedInputStream::ReadVarint64Fast(uint64_t& result) {
+    const uint8_t* end = DecodeVarint64Unrolled(ptr_, result);
+    if (end == nullptr) {
+        // overflow
+        ptr_ += kMaxVarintSize;
+        return false;
+    }
+    ptr_ = end;
+    return true;
+}
+
+bool CodedInputStream::ReadVarint64Slow(uint64_t& result) {
     result = 0;
     uint32_t shift = 0;
     uint8_t b;
-    while (input_.Read(b)) {
+    while (ReadByte(b)) {
         result |= static_cast<uint64_t>(b & 0x7f) << shift;
         shift += 7;
         if ((b & 0x80) == 0) {
@@ -25,67 +291,142 @@ bool CodedInputStream::ReadVarint64(uint64_t& result) {
     return false;
 }
 
-bool CodedInputStream::ReadFixedInt32(uint32_t& result) {
-    result = 0;
-    uint8_t b;
-    for (int i = 0; i < 4; i++) {
-        if (!input_.Read(b)) {
+template <typename T>
+bool CodedInputStream::ReadVarintArrayImpl(
+        std::vector<T>& result, size_t len, bool zigzag) {
+    if (direct_ && len <= static_cast<size_t>(limit_ - ptr_)) {
+        const uint8_t* data = ptr_;
+        ptr_ += len;
+        return DecodeVarintBatch(data, len, result, zigzag);
+    }
+
+    // The varints span multiple chunks, or we can't see the buffer.
+    std::vector<uint8_t> buffer;
+    size_t read_size = 0;
+    while (read_size < len) {
+        size_t chunk_size = std::min(len - read_size, kReadStringChunkSize);
+        buffer.resize(read_size + chunk_size);
+        if (!ReadRaw(&buffer[read_size], chunk_size)) {
             return false;
         }
-        // Little-endian
-        result |= static_cast<uint32_t>(b) << (i * 8);
+        read_size += chunk_size;
     }
+    return DecodeVarintBatch(buffer.data(), len, result, zigzag);
+}
+
+bool CodedInputStream::ReadVarintArray(
+        std::vector<uint32_t>& result, size_t len, bool zigzag) {
+    return ReadVarintArrayImpl(result, len, zigzag);
+}
+
+bool CodedInputStream::ReadVarintArray(
+        std::vector<uint64_t>& result, size_t len, bool zigzag) {
+    return ReadVarintArrayImpl(result, len, zigzag);
+}
+
+bool CodedInputStream::ReadFixedInt32(uint32_t& result) {
+    if (!ReadRaw(reinterpret_cast<uint8_t*>(&result), sizeof(result))) {
+        return false;
+    }
+    result = LittleEndian32(result);
     return true;
 }
 
 bool CodedInputStream::ReadFixedInt64(uint64_t& result) {
-    result = 0;
-    uint8_t b;
-    for (int i = 0; i < 8; i++) {
-        if (!input_.Read(b)) {
-            return false;
-        }
-        // Little-endian
-        result |= static_cast<uint64_t>(b) << (i * 8);
+    if (!ReadRaw(reinterpret_cast<uint8_t*>(&result), sizeof(result))) {
+        return false;
     }
+    result = LittleEndian64(result);
     return true;
 }
 
-bool CodedOutputStream::WriteVarint64(uint64_t value) {
+bool CodedOutputStream::Refresh() {
+    if (zero_copy_ == nullptr) {
+        return false;
+    }
+    chunks_written_ += ptr_ - buffer_start_;
+    buffer_start_ = ptr_ = limit_;
+
+    void* data;
+    int size;
     do {
-        uint8_t b = value & 0x7f;
-        value = value >> 7;
-        if (value > 0) {
-            // set continuation bit
-            b |= 0x80;
-        }
-        if (!output_.Write(b)) {
+        if (!zero_copy_->Next(&data, &size)) {
             return false;
         }
-    } while (value > 0);
+    } while (size <= 0);
+
+    buffer_start_ = static_cast<uint8_t*>(data);
+    ptr_ = buffer_start_;
+    limit_ = buffer_start_ + size;
     return true;
 }
 
-bool CodedOutputStream::WriteFixedInt32(uint32_t value) {
-    for (int i = 0; i < 4; i++) {
-        uint8_t b = value & 0xff;
-        value = value >> 8;
-        if (!output_.Write(b)) {
+bool CodedOutputStream::WriteByteSlow(uint8_t value) {
+    if (!direct_) {
+        if (!output_.Write(value)) {
+            had_error_ = true;
             return false;
         }
+        return true;
+    }
+    if (!Refresh()) {
+        had_error_ = true;
+        return false;
     }
+    *ptr_++ = value;
     return true;
 }
 
-bool CodedOutputStream::WriteFixedInt64(uint64_t value) {
-    for (int i = 0; i < 8; i++) {
-        uint8_t b = value & 0xff;
-        value = value >> 8;
-        if (!output_.Write(b)) {
+bool CodedOutputStream::WriteRaw(const uint8_t* data, size_t len) {
+    if (!direct_) {
+        if (!output_.WriteBytes(data, len)) {
+            had_error_ = true;
+            return false;
+        }
+        return true;
+    }
+    if (zero_copy_ == nullptr && len > static_cast<size_t>(limit_ - ptr_)) {
+        // Don't write a partial value into a flat buffer.
+        had_error_ = true;
+        return false;
+    }
+
+    while (len > static_cast<size_t>(limit_ - ptr_)) {
+        size_t available = limit_ - ptr_;
+        std::copy(data, data + available, ptr_);
+        ptr_ += available;
+        data += available;
+        len -= available;
+        if (!Refresh()) {
+            had_error_ = true;
             return false;
         }
     }
+    std::copy(data, data + len, ptr_);
+    ptr_ += len;
     return true;
 }
 
+bool CodedOutputStream::WriteVarint64Slow(uint64_t value) {
+    uint8_t buf[kMaxVarintSize];
+    size_t size = 0;
+    while (value >= 0x80) {
+        // set continuation bit
+        buf[size++] = static_cast<uint8_t>(value) | 0x80;
+        value >>= 7;
+    }
+    buf[size++] = static_cast<uint8_t>(value);
+    return WriteRaw(buf, size);
+}
+
+bool CodedOutputStream::WriteFixedInt32(uint32_t value) {
+    value = LittleEndian32(value);
+    return WriteRaw(reinterpret_cast<const uint8_t*>(&value), sizeof(value));
+}
+
+bool CodedOutputStream::WriteFixedInt64(uint64_t value) {
+    value = LittleEndian64(value);
+    return WriteRaw(reinterpret_cast<const uint8_t*>(&value), sizeof(value));
+}
+
 }  // namespace decaproto
@@ -1,9 +1,16 @@
 #ifndef DECAPROTO_CODED_STREAM_H
 #define DECAPROTO_CODED_STREAM_H
 
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
 
 #include "decaproto/stream/stream.h"
+#include "decaproto/stream/zero_copy_stream.h"
 
 namespace decaproto {
 
@@ -22,6 +29,53 @@ enum WireType {
     kI32 = 5,
 };
 
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define DECAPROTO_BIG_ENDIAN 1
+#endif
+
+// Converts a value between the host byte order and little-endian, the byte
+// order of fixed-width values on the wire.
+inline uint32_t LittleEndian32(uint32_t value) {
+#ifdef DECAPROTO_BIG_ENDIAN
+    return __builtin_bswap32(value);
+#else
+    return value;
+#endif
+}
+
+inline uint64_t LittleEndian64(uint64_t value) {
+#ifdef DECAPROTO_BIG_ENDIAN
+    return __builtin_bswap64(value);
+#else
+    return value;
+#endif
+}
+
+// Converts `count` 4- or 8-byte values in place. No-op on little-endian
+// hosts.
+template <typename T>
+inline void LittleEndianArray(T* values, size_t count) {
+    static_assert(sizeof(T) == 4 || sizeof(T) == 8, "Not a fixed-width type");
+#ifdef DECAPROTO_BIG_ENDIAN
+    for (size_t i = 0; i < count; i++) {
+        if (sizeof(T) == 4) {
+            uint32_t v;
+            std::memcpy(&v, &values[i], sizeof(v));
+            v = LittleEndian32(v);
+            std::memcpy(&values[i], &v, sizeof(v));
+        } else {
+            uint64_t v;
+            std::memcpy(&v, &values[i], sizeof(v));
+            v = LittleEndian64(v);
+            std::memcpy(&values[i], &v, sizeof(v));
+        }
+    }
+#else
+    (void)values;
+    (void)count;
+#endif
+}
+
 // Wraps InputStream to provide additional functionality.
 class InputStreamWrapper final {
     InputStream* input_;
@@ -39,6 +93,22 @@ public:
         return true;
     }
 
+    bool ReadBytes(std::uint8_t* out, size_t len) {
+        if (!input_->ReadBytes(out, len)) {
+            return false;
+        }
+        consumed_ += len;
+        return true;
+    }
+
+    bool Skip(size_t len) {
+        if (!input_->Skip(len)) {
+            return false;
+        }
+        consumed_ += len;
+        return true;
+    }
+
     // How much data has been consumed from the stream.
     size_t ConsumedSize() {
         return consumed_;
@@ -62,6 +132,14 @@ public:
         return true;
     }
 
+    bool WriteBytes(const std::uint8_t* data, size_t len) {
+        if (!output_->WriteBytes(data, len)) {
+            return false;
+        }
+        written_ += len;
+        return true;
+    }
+
     // How much data has been written to the stream.
     size_t WrittenSize() {
         return written_;
@@ -69,40 +147,159 @@ public:
 };
 
 // Reads and decodes a varint from the input stream.
+//
+// If the stream is backed by a flat buffer (see
+// InputStream::GetDirectBuffer) or is a ZeroCopyInputStream, CodedInputStream
+// reads the buffer through a raw pointer without any virtual calls, and moves
+// on to the next chunk only when the current one is exhausted. Otherwise it
+// reads the stream through InputStreamWrapper.
 class CodedInputStream {
 public:
-    CodedInputStream(InputStream* input) : input_(input) {
+    CodedInputStream(InputStream* input)
+        : stream_(input),
+          input_(input),
+          zero_copy_(nullptr),
+          chunks_consumed_(0),
+          direct_(false),
+          buffer_start_(nullptr),
+          ptr_(nullptr),
+          limit_(nullptr),
+          buffer_end_(nullptr),
+          current_limit_(SIZE_MAX),
+          aliasing_(false) {
+        const uint8_t* data = nullptr;
+        size_t size = 0;
+        if (input->GetDirectBuffer(data, size)) {
+            direct_ = true;
+            buffer_start_ = data;
+            ptr_ = data;
+            limit_ = data + size;
+            buffer_end_ = limit_;
+        }
     }
 
-    ~CodedInputStream() {
+    // Reads `size` bytes starting from `data`.
+    // The buffer must outlive the CodedInputStream.
+    CodedInputStream(const uint8_t* data, size_t size)
+        : stream_(nullptr),
+          input_(nullptr),
+          zero_copy_(nullptr),
+          chunks_consumed_(0),
+          direct_(true),
+          buffer_start_(data),
+          ptr_(data),
+          limit_(data + size),
+          buffer_end_(data + size),
+          current_limit_(SIZE_MAX),
+          aliasing_(false) {
+    }
+
+    // Reads chunks provided by `input` one by one.
+    CodedInputStream(ZeroCopyInputStream* input)
+        : stream_(nullptr),
+          input_(nullptr),
+          zero_copy_(input),
+          chunks_consumed_(0),
+          direct_(true),
+          buffer_start_(nullptr),
+          ptr_(nullptr),
+          limit_(nullptr),
+          buffer_end_(nullptr),
+          current_limit_(SIZE_MAX),
+          aliasing_(false) {
     }
 
-    void Skip(size_t len) {
-        // Temporal implementation to InputStream's interface as simple as
-        // possible while developing the library.
-        uint8_t b;
-        for (size_t i = 0; i < len; i++) {
-            input_.Read(b);
+    ~CodedInputStream() {
+        if (zero_copy_ != nullptr && ptr_ < buffer_end_) {
+            // Return the unread part of the current chunk to the stream.
+            zero_copy_->BackUp(buffer_end_ - ptr_);
+        }
+        if (direct_ && stream_ != nullptr) {
+            // Tell the stream how much data we have read from its buffer.
+            stream_->ConsumeDirectBuffer(ptr_ - buffer_start_);
         }
     }
 
+    // Skips `len` bytes. Buffers are skipped by moving the pointer, and other
+    // streams by InputStream::Skip().
+    // Returns false if the stream ends before `len` bytes are skipped.
+    bool Skip(size_t len);
+
     size_t ConsumedSize() {
-        return input_.ConsumedSize();
+        return input_.ConsumedSize() + chunks_consumed_ +
+               (ptr_ - buffer_start_);
     }
 
-    bool ReadString(std::string& result, size_t len) {
-        result.clear();
-        for (size_t i = 0; i < len; i++) {
-            uint8_t b;
-            if (!input_.Read(b)) {
-                return false;
-            }
-            result.push_back(b);
+    // Limits reading to the next `size` bytes (e.g. the body of a
+    // sub-message). Reads beyond the limit fail as if the stream ended
+    // there. The fast paths see the limit as the end of the buffer, so it
+    // costs nothing per byte.
+    //
+    // Limits nest. Returns false and pushes nothing if the new limit goes
+    // beyond the current one.
+    bool PushLimit(size_t size);
+
+    // Restores the limit before the last PushLimit().
+    void PopLimit();
+
+    // True if we are at the current limit. In most cases it's just one
+    // pointer comparison.
+    bool ReachedLimit() {
+        return ptr_ == limit_ && BytesUntilLimit() == 0;
+    }
+
+    // How many bytes can be read before the current limit.
+    // SIZE_MAX if no limit is pushed.
+    size_t BytesUntilLimit() {
+        if (current_limit_ == SIZE_MAX) {
+            return SIZE_MAX;
         }
+        return current_limit_ - ConsumedSize();
+    }
+
+    bool ReadString(std::string& result, size_t len);
+
+    // Sets `result` to the next `len` bytes in the buffer without copying
+    // them. The view stays valid as long as the buffer does.
+    //
+    // Only flat buffers (the buffer passed to the constructor or the direct
+    // buffer of an InputStream) can be aliased. Chunks of a
+    // ZeroCopyInputStream may be reused once we move on to the next one.
+    // Returns false and consumes nothing if the bytes aren't available in a
+    // flat buffer. Use ReadString() in that case.
+    bool ReadStringView(std::string_view& result, size_t len) {
+        if (!direct_ || zero_copy_ != nullptr ||
+            len > static_cast<size_t>(limit_ - ptr_)) {
+            return false;
+        }
+        result = std::string_view(reinterpret_cast<const char*>(ptr_), len);
+        ptr_ += len;
         return true;
     }
 
-    bool ReadVarint64(uint64_t& result);
+    // Lets decoders store string fields as views into the buffer (see
+    // ReadStringView) instead of copies, so the buffer must outlive the
+    // decoded messages. Fields which can't alias the buffer are copied as
+    // usual.
+    void EnableAliasing(bool enabled) {
+        aliasing_ = enabled;
+    }
+
+    bool AliasingEnabled() const {
+        return aliasing_;
+    }
+
+    bool ReadVarint64(uint64_t& result) {
+        if (ptr_ < limit_ && *ptr_ < 0x80) {
+            // Most of tags and small numbers fit in one byte.
+            result = *ptr_++;
+            return true;
+        }
+        if (limit_ - ptr_ >= kMaxVarintSize) {
+            return ReadVarint64Fast(result);
+        }
+        return ReadVarint64Slow(result);
+    }
 
     bool ReadVarint32(uint32_t& result) {
         uint64_t result64;
@@ -134,6 +331,78 @@ public:
     bool ReadFixedInt32(uint32_t& result);
     bool ReadFixedInt64(uint64_t& result);
 
+    // Decodes `len` bytes of consecutive varints (e.g. a packed repeated
+    // field) with DecodeVarintBatch and appends them to `result`.
+    // If the bytes are in the current buffer, they are decoded in place.
+    // Otherwise they are copied out of the stream first.
+    bool ReadVarintArray(
+            std::vector<uint32_t>& result, size_t len, bool zigzag = false);
+    bool ReadVarintArray(
+            std::vector<uint64_t>& result, size_t len, bool zigzag = false);
+
+    // Same as above for other element types such as int32_t, bool or enums.
+    // The varints are decoded as 32-bit values for 4-byte types (truncated
+    // like int32 values) and as 64-bit values otherwise, and then converted
+    // to T.
+    template <typename T>
+    bool ReadVarintArray(
+            std::vector<T>& result, size_t len, bool zigzag = false) {
+        using Raw = typename std::conditional<
+                sizeof(T) == 4 && !std::is_same<T, bool>::value,
+                uint32_t,
+                uint64_t>::type;
+        std::vector<Raw> values;
+        if (!ReadVarintArray(values, len, zigzag)) {
+            return false;
+        }
+        result.reserve(result.size() + values.size());
+        for (Raw value : values) {
+            result.push_back(static_cast<T>(value));
+        }
+        return true;
+    }
+
+    // Reads `len` bytes of consecutive fixed-width values (e.g. a packed
+    // repeated double field) and appends them to `result`.
+    // T is a 4- or 8-byte type such as uint32_t, float or double. The bytes
+    // are copied into the vector at once and, on big-endian hosts, swapped
+    // afterwards. Returns false if `len` isn't a multiple of sizeof(T).
+    template <typename T>
+    bool ReadFixedArray(std::vector<T>& result, size_t len) {
+        static_assert(
+                sizeof(T) == 4 || sizeof(T) == 8, "Not a fixed-width type");
+        if (len % sizeof(T) != 0) {
+            return false;
+        }
+        size_t old_size = result.size();
+        size_t count = len / sizeof(T);
+        if (direct_ && len <= static_cast<size_t>(limit_ - ptr_)) {
+            result.resize(old_size + count);
+            std::memcpy(&result[old_size], ptr_, len);
+            ptr_ += len;
+        } else {
+            // Grow the vector step by step so that a broken length prefix
+            // doesn't make us allocate a huge buffer.
+            size_t read = 0;
+            while (read < count) {
+                size_t n = std::min(
+                        count - read, kFixedArrayChunkSize / sizeof(T));
+                result.resize(old_size + read + n);
+                if (!ReadRaw(
+                            reinterpret_cast<uint8_t*>(
+                                    &result[old_size + read]),
+                            n * sizeof(T))) {
+                    // Don't leave the elements read so far.
+                    result.resize(old_size);
+                    return false;
+                }
+                read += n;
+            }
+        }
+        LittleEndianArray(result.data() + old_size, count);
+        return true;
+    }
+
     static int64_t DecodeZigZag64(uint64_t value) {
         return (value >> 1) ^ -(value & 1);
     }
@@ -143,19 +412,138 @@ public:
     }
 
 private:
+    inline bool ReadByte(uint8_t& out) {
+        if (ptr_ < limit_) {
+            out = *ptr_++;
+            return true;
+        }
+        return ReadByteSlow(out);
+    }
+
+    bool ReadByteSlow(uint8_t& out);
+    bool ReadRaw(uint8_t* out, size_t len);
+
+    static constexpr ptrdiff_t kMaxVarintSize = 10;
+    static constexpr size_t kFixedArrayChunkSize = 4096;
+
+    // Decodes a varint without checking the end of the buffer for each byte.
+    // At least kMaxVarintSize bytes must be available in the buffer.
+    bool ReadVarint64Fast(uint64_t& result);
+    bool ReadVarint64Slow(uint64_t& result);
+
+    template <typename T>
+    bool ReadVarintArrayImpl(std::vector<T>& result, size_t len, bool zigzag);
+
+    // Moves on to the next non-empty chunk of zero_copy_.
+    // Returns false if there is no more chunk or we are at the limit.
+    bool Refresh();
+
+    // Sets limit_ to the current limit if it's in the current buffer, or to
+    // the end of the buffer otherwise.
+    void UpdateLimit();
+
+    InputStream* stream_;
     InputStreamWrapper input_;
+
+    ZeroCopyInputStream* zero_copy_;
+    // Total size of the chunks we have finished reading.
+    size_t chunks_consumed_;
+
+    // True if we are reading [ptr_, limit_) directly instead of input_.
+    bool direct_;
+    const uint8_t* buffer_start_;
+    const uint8_t* ptr_;
+    // End of the readable part of the buffer, which is buffer_end_ or the
+    // current limit, whichever comes first.
+    const uint8_t* limit_;
+    const uint8_t* buffer_end_;
+
+    // Position of the current limit in ConsumedSize(), or SIZE_MAX.
+    size_t current_limit_;
+    std::vector<size_t> limit_stack_;
+
+    // See EnableAliasing().
+    bool aliasing_;
 };
 
+// Encodes values and writes them to the output stream.
+//
+// Like CodedInputStream, CodedOutputStream writes into the buffer of the
+// stream directly if the stream is backed by a flat buffer (see
+// OutputStream::GetDirectBuffer) or is a ZeroCopyOutputStream.
 class CodedOutputStream {
 public:
-    CodedOutputStream(OutputStream* output) : output_(output) {
+    CodedOutputStream(OutputStream* output)
+        : stream_(output),
+          output_(output),
+          zero_copy_(nullptr),
+          chunks_written_(0),
+          direct_(false),
+          buffer_start_(nullptr),
+          ptr_(nullptr),
+          limit_(nullptr),
+          had_error_(false) {
+        uint8_t* data = nullptr;
+        size_t size = 0;
+        if (output->GetDirectBuffer(data, size)) {
+            direct_ = true;
+            buffer_start_ = data;
+            ptr_ = data;
+            limit_ = data + size;
+        }
+    }
+
+    // Writes into `size` bytes of memory starting from `data`.
+    // Writes fail once the buffer is full.
+    CodedOutputStream(uint8_t* data, size_t size)
+        : stream_(nullptr),
+          output_(nullptr),
+          zero_copy_(nullptr),
+          chunks_written_(0),
+          direct_(true),
+          buffer_start_(data),
+          ptr_(data),
+          limit_(data + size),
+          had_error_(false) {
+    }
+
+    // Writes into chunks provided by `output` one by one.
+    CodedOutputStream(ZeroCopyOutputStream* output)
+        : stream_(nullptr),
+          output_(nullptr),
+          zero_copy_(output),
+          chunks_written_(0),
+          direct_(true),
+          buffer_start_(nullptr),
+          ptr_(nullptr),
+          limit_(nullptr),
+          had_error_(false) {
     }
 
     ~CodedOutputStream() {
+        if (zero_copy_ != nullptr && ptr_ < limit_) {
+            // Return the unused part of the current chunk to the stream.
+            zero_copy_->BackUp(limit_ - ptr_);
+        }
+        if (direct_ && stream_ != nullptr) {
+            // Tell the stream how much data we have written to its buffer.
+            stream_->CommitDirectBuffer(ptr_ - buffer_start_);
+        }
     }
 
     size_t WrittenSize() {
-        return output_.WrittenSize();
+        return output_.WrittenSize() + chunks_written_ +
+               (ptr_ - buffer_start_);
+    }
+
+    // Returns true if any write has failed since the stream was created.
+    //
+    // Once a write fails (the buffer is full or the underlying stream
+    // refuses data), the flag stays set. Callers writing many values, like
+    // generated EncodeImpl(), can ignore the result of each write and check
+    // HadError() once at the end.
+    bool HadError() const {
+        return had_error_;
     }
 
     inline bool WriteTag(uint32_t field_number, WireType wire_type) {
@@ -163,17 +551,40 @@ public:
         return WriteVarint32(tag);
     }
 
-    bool WriteString(const std::string& result) {
-        for (size_t i = 0; i < result.size(); i++) {
-            uint8_t b = result[i];
-            if (!output_.Write(b)) {
-                return false;
-            }
+    // Writes a tag encoded in advance (e.g. by the code generator) with one
+    // fixed-length copy instead of encoding it as a varint.
+    template <size_t N>
+    bool WriteRawTag(const uint8_t (&tag)[N]) {
+        if (limit_ - ptr_ >= static_cast<ptrdiff_t>(N)) {
+            std::memcpy(ptr_, tag, N);
+            ptr_ += N;
+            return true;
         }
-        return true;
+        return WriteRaw(tag, N);
     }
 
-    bool WriteVarint64(uint64_t value);
+    bool WriteString(std::string_view result) {
+        return WriteRaw(
+                reinterpret_cast<const uint8_t*>(result.data()),
+                result.size());
+    }
+
+    bool WriteVarint64(uint64_t value) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        if (value < (1ULL << 56) && limit_ - ptr_ >= kMaxVarintSize) {
+            // Varints up to 8 bytes are assembled in a register and stored
+            // at once. Bytes after the varint are overwritten by the next
+            // value or left outside of the written size.
+            size_t size = VarintSize64(value);
+            uint64_t bytes = SpreadVarintBytes(value);
+            bytes |= 0x8080808080808080ULL & ((1ULL << (8 * (size - 1))) - 1);
+            std::memcpy(ptr_, &bytes, sizeof(bytes));
+            ptr_ += size;
+            return true;
+        }
+#endif
+        return WriteVarint64Slow(value);
+    }
 
     bool WriteVarint32(uint32_t value) {
         return WriteVarint64(value);
@@ -191,6 +602,34 @@ public:
     bool WriteFixedInt32(uint32_t value);
     bool WriteFixedInt64(uint64_t value);
 
+    // Writes fixed-width values back to back (e.g. the payload of a packed
+    // repeated double field). T is a 4- or 8-byte type such as uint32_t,
+    // float or double. On little-endian hosts, the whole array is written
+    // with one WriteRaw() call.
+    template <typename T>
+    bool WriteFixedArray(const std::vector<T>& values) {
+        static_assert(
+                sizeof(T) == 4 || sizeof(T) == 8, "Not a fixed-width type");
+#ifdef DECAPROTO_BIG_ENDIAN
+        // Swap the values in a local buffer chunk by chunk.
+        T buf[64];
+        for (size_t i = 0; i < values.size(); i += 64) {
+            size_t n = std::min<size_t>(values.size() - i, 64);
+            std::copy(values.begin() + i, values.begin() + i + n, buf);
+            LittleEndianArray(buf, n);
+            if (!WriteRaw(reinterpret_cast<const uint8_t*>(buf),
+                          n * sizeof(T))) {
+                return false;
+            }
+        }
+        return true;
+#else
+        return WriteRaw(
+                reinterpret_cast<const uint8_t*>(values.data()),
+                values.size() * sizeof(T));
+#endif
+    }
+
     static uint64_t EncodeZigZag(int64_t value) {
         return (value << 1) ^ (value >> 63);
     }
@@ -199,8 +638,67 @@ public:
         return (value << 1) ^ (value >> 31);
     }
 
+    // How many bytes the varint encoding of `value` takes.
+    static size_t VarintSize64(uint64_t value) {
+#ifdef __GNUC__
+        // Each byte holds 7 bits: ceil(bits / 7) computed as
+        // (bits * 9 + 64) / 64, where bits is at least 1 for value 0.
+        uint32_t bits = 64 - __builtin_clzll(value | 1);
+        return (bits * 9 + 64) / 64;
+#else
+        size_t size = 1;
+        while (value >= 0x80) {
+            value >>= 7;
+            size++;
+        }
+        return size;
+#endif
+    }
+
 private:
+    inline bool WriteByte(uint8_t value) {
+        if (ptr_ < limit_) {
+            *ptr_++ = value;
+            return true;
+        }
+        return WriteByteSlow(value);
+    }
+
+    bool WriteByteSlow(uint8_t value);
+    bool WriteRaw(const uint8_t* data, size_t len);
+
+    static constexpr ptrdiff_t kMaxVarintSize = 10;
+
+    // Moves each 7-bit group of `value` (< 2^56) to its own byte.
+    static uint64_t SpreadVarintBytes(uint64_t x) {
+        x = (x & 0x000000000fffffffULL) | ((x & 0x00fffffff0000000ULL) << 4);
+        x = (x & 0x00003fff00003fffULL) | ((x & 0x0fffc0000fffc000ULL) << 2);
+        x = (x & 0x007f007f007f007fULL) | ((x & 0x3f803f803f803f80ULL) << 1);
+        return x;
+    }
+
+    // Encodes the varint into a local buffer and writes it with WriteRaw.
+    bool WriteVarint64Slow(uint64_t value);
+
+    // Moves on to the next non-empty chunk of zero_copy_.
+    // Returns false if there is no more chunk.
+    bool Refresh();
+
+    OutputStream* stream_;
     OutputStreamWrapper output_;
+
+    ZeroCopyOutputStream* zero_copy_;
+    // Total size of the chunks we have filled.
+    size_t chunks_written_;
+
+    // True if we are writing into [ptr_, limit_) directly instead of output_.
+    bool direct_;
+    uint8_t* buffer_start_;
+    uint8_t* ptr_;
+    uint8_t* limit_;
+
+    // Set when a write fails. See HadError().
+    bool had_error_;
 };
 
 }  // namespace decaproto
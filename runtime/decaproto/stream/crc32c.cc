@@ -0,0 +1,123 @@
+#include "decaproto/stream/crc32c.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define DECAPROTO_CRC32C_X86 1
+#include <nmmintrin.h>
+
+#include <cstring>
+#endif
+
+namespace decaproto {
+
+namespace {
+
+// CRC32C polynomial in the reversed bit order
+const uint32_t kPolynomial = 0x82f63b78;
+
+// Lookup tables for slicing-by-8.
+// table[0] is the usual byte-wise table, and table[k][b] is the CRC of byte b
+// followed by k zero bytes, so that 8 bytes can be folded with 8 independent
+// lookups.
+struct SlicingTables {
+    uint32_t table[8][256];
+
+    SlicingTables() {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; bit++) {
+                crc = (crc >> 1) ^ (kPolynomial & -(crc & 1));
+            }
+            table[0][i] = crc;
+        }
+        for (uint32_t i = 0; i < 256; i++) {
+            for (int k = 1; k < 8; k++) {
+                uint32_t prev = table[k - 1][i];
+                table[k][i] = (prev >> 8) ^ table[0][prev & 0xff];
+            }
+        }
+    }
+};
+
+const SlicingTables& Tables() {
+    static const SlicingTables tables;
+    return tables;
+}
+
+inline uint32_t LoadLittleEndian32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) |
+           (static_cast<uint32_t>(p[3]) << 24);
+}
+
+#ifdef DECAPROTO_CRC32C_X86
+
+__attribute__((target("sse4.2"))) uint32_t ExtendSse42(
+        uint32_t crc, const uint8_t* p, size_t len) {
+    crc = ~crc;
+#ifdef __x86_64__
+    uint64_t crc64 = crc;
+    while (len >= 8) {
+        uint64_t value;
+        std::memcpy(&value, p, sizeof(value));
+        crc64 = _mm_crc32_u64(crc64, value);
+        p += 8;
+        len -= 8;
+    }
+    crc = static_cast<uint32_t>(crc64);
+#endif
+    while (len >= 4) {
+        uint32_t value;
+        std::memcpy(&value, p, sizeof(value));
+        crc = _mm_crc32_u32(crc, value);
+        p += 4;
+        len -= 4;
+    }
+    while (len > 0) {
+        crc = _mm_crc32_u8(crc, *p++);
+        len--;
+    }
+    return ~crc;
+}
+
+#endif  // DECAPROTO_CRC32C_X86
+
+typedef uint32_t (*ExtendFunction)(uint32_t, const uint8_t*, size_t);
+
+ExtendFunction DetectExtendFunction() {
+#ifdef DECAPROTO_CRC32C_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.2")) {
+        return ExtendSse42;
+    }
+#endif
+    return ExtendCrc32cPortable;
+}
+
+}  // namespace
+
+uint32_t ExtendCrc32cPortable(uint32_t crc, const uint8_t* p, size_t len) {
+    const uint32_t(*t)[256] = Tables().table;
+    crc = ~crc;
+    while (len >= 8) {
+        uint32_t lo = crc ^ LoadLittleEndian32(p);
+        uint32_t hi = LoadLittleEndian32(p + 4);
+        crc = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff] ^
+              t[5][(lo >> 16) & 0xff] ^ t[4][lo >> 24] ^ t[3][hi & 0xff] ^
+              t[2][(hi >> 8) & 0xff] ^ t[1][(hi >> 16) & 0xff] ^
+              t[0][hi >> 24];
+        p += 8;
+        len -= 8;
+    }
+    while (len > 0) {
+        crc = t[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+        len--;
+    }
+    return ~crc;
+}
+
+uint32_t ExtendCrc32c(uint32_t crc, const uint8_t* data, size_t len) {
+    static const ExtendFunction extend = DetectExtendFunction();
+    return extend(crc, data, len);
+}
+
+}  // namespace decaproto
@@ -0,0 +1,162 @@
+#ifndef DECAPROTO_STREAM_CRC32C_H
+#define DECAPROTO_STREAM_CRC32C_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "decaproto/stream/stream.h"
+
+namespace decaproto {
+
+// Returns the CRC32C (Castagnoli) of `data` appended to data whose CRC32C is
+// `crc`. Start from 0 for a new checksum, e.g.
+//
+//   uint32_t crc = ExtendCrc32c(0, header, header_size);
+//   crc = ExtendCrc32c(crc, payload, payload_size);
+//
+// On x86 CPUs supporting SSE4.2 (detected at runtime), the crc32 instruction
+// processes 8 bytes at a time. Otherwise, a slicing-by-8 table lookup is used.
+uint32_t ExtendCrc32c(uint32_t crc, const uint8_t* data, size_t len);
+
+// Slicing-by-8 implementation of ExtendCrc32c() used when the CPU has no
+// CRC32C instruction. Exposed for tests and benchmarks.
+uint32_t ExtendCrc32cPortable(uint32_t crc, const uint8_t* data, size_t len);
+
+inline uint32_t Crc32c(const uint8_t* data, size_t len) {
+    return ExtendCrc32c(0, data, len);
+}
+
+// Passes the bytes written by e.g. CodedOutputStream through to `output` and
+// computes their CRC32C on the way.
+//
+// If `output` exposes a direct buffer, it's exposed as is, and the checksum
+// is computed over the whole committed region at once. Otherwise, blocks
+// written with WriteBytes() are checksummed as a whole.
+class Crc32cOutputStream : public OutputStream {
+    OutputStream* output_;
+    uint32_t crc_;
+    size_t written_;
+    // The region returned by the last GetDirectBuffer()
+    uint8_t* direct_data_;
+
+public:
+    Crc32cOutputStream(OutputStream* output)
+        : output_(output), crc_(0), written_(0), direct_data_(nullptr) {
+    }
+
+    virtual ~Crc32cOutputStream() {
+    }
+
+    bool Write(uint8_t ch) override {
+        if (!output_->Write(ch)) {
+            return false;
+        }
+        crc_ = ExtendCrc32c(crc_, &ch, 1);
+        written_++;
+        return true;
+    }
+
+    bool WriteBytes(const uint8_t* data, size_t len) override {
+        if (!output_->WriteBytes(data, len)) {
+            return false;
+        }
+        crc_ = ExtendCrc32c(crc_, data, len);
+        written_ += len;
+        return true;
+    }
+
+    bool GetDirectBuffer(uint8_t*& data, size_t& size) override {
+        if (!output_->GetDirectBuffer(data, size)) {
+            return false;
+        }
+        direct_data_ = data;
+        return true;
+    }
+
+    void CommitDirectBuffer(size_t len) override {
+        crc_ = ExtendCrc32c(crc_, direct_data_, len);
+        written_ += len;
+        direct_data_ = nullptr;
+        output_->CommitDirectBuffer(len);
+    }
+
+    // CRC32C of the bytes written so far.
+    uint32_t Crc() const {
+        return crc_;
+    }
+
+    size_t WrittenSize() const {
+        return written_;
+    }
+};
+
+// Passes the bytes read by e.g. CodedInputStream through from `input` and
+// computes their CRC32C on the way.
+//
+// If `input` exposes a direct buffer, it's exposed as is, and the checksum
+// is computed over the whole consumed region at once.
+class Crc32cInputStream : public InputStream {
+    InputStream* input_;
+    uint32_t crc_;
+    size_t consumed_;
+    // The region returned by the last GetDirectBuffer()
+    const uint8_t* direct_data_;
+
+public:
+    Crc32cInputStream(InputStream* input)
+        : input_(input), crc_(0), consumed_(0), direct_data_(nullptr) {
+    }
+
+    virtual ~Crc32cInputStream() {
+    }
+
+    bool Read(uint8_t& out) override {
+        if (!input_->Read(out)) {
+            return false;
+        }
+        crc_ = ExtendCrc32c(crc_, &out, 1);
+        consumed_++;
+        return true;
+    }
+
+    bool ReadBytes(uint8_t* out, size_t len) override {
+        if (!input_->ReadBytes(out, len)) {
+            return false;
+        }
+        crc_ = ExtendCrc32c(crc_, out, len);
+        consumed_ += len;
+        return true;
+    }
+
+    // Skipped bytes must be checksummed too, so they are read instead of
+    // being skipped by the underlying stream. The default implementation does
+    // it through ReadBytes().
+
+    bool GetDirectBuffer(const uint8_t*& data, size_t& size) override {
+        if (!input_->GetDirectBuffer(data, size)) {
+            return false;
+        }
+        direct_data_ = data;
+        return true;
+    }
+
+    void ConsumeDirectBuffer(size_t len) override {
+        crc_ = ExtendCrc32c(crc_, direct_data_, len);
+        consumed_ += len;
+        direct_data_ = nullptr;
+        input_->ConsumeDirectBuffer(len);
+    }
+
+    // CRC32C of the bytes read so far.
+    uint32_t Crc() const {
+        return crc_;
+    }
+
+    size_t ConsumedSize() const {
+        return consumed_;
+    }
+};
+
+}  // namespace decaproto
+
+#endif  // DECAPROTO_STREAM_CRC32C_H
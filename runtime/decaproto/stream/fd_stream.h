@@ -0,0 +1,262 @@
+#ifndef DECAPROTO_STREAM_FD_STREAM_H
+#define DECAPROTO_STREAM_FD_STREAM_H
+
+// POSIX only. This header isn't included by the rest of the runtime so that
+// the library still builds on platforms without file descriptors (e.g.
+// Arduino).
+
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "decaproto/stream/stream.h"
+
+namespace decaproto {
+
+// InputStream which reads a file descriptor (file, pipe or socket) block by
+// block.
+// The file descriptor isn't closed by the stream.
+//
+// Data buffered but not read is lost when the stream is destroyed, since it
+// can't be pushed back into pipes or sockets.
+class FdInputStream : public InputStream {
+    int fd_;
+    std::vector<uint8_t> buffer_;
+    // [position_, size_) of buffer_ hasn't been read yet.
+    size_t position_;
+    size_t size_;
+    size_t byte_count_;
+    // errno of the last failed read(2), or 0.
+    int errno_;
+
+    // Calls read(2) until it succeeds or fails with an error other than
+    // EINTR. Returns the number of bytes read, or 0 on EOF and errors.
+    size_t ReadFromFd(uint8_t* out, size_t len) {
+        ssize_t result;
+        do {
+            result = read(fd_, out, len);
+        } while (result < 0 && errno == EINTR);
+        if (result < 0) {
+            errno_ = errno;
+            return 0;
+        }
+        return result;
+    }
+
+    bool Fill() {
+        position_ = 0;
+        size_ = ReadFromFd(buffer_.data(), buffer_.size());
+        return size_ > 0;
+    }
+
+public:
+    FdInputStream(int fd, size_t block_size = 65536)
+        : fd_(fd),
+          buffer_(block_size),
+          position_(0),
+          size_(0),
+          byte_count_(0),
+          errno_(0) {
+    }
+
+    virtual ~FdInputStream() {
+    }
+
+    bool Read(uint8_t& out) override {
+        if (position_ >= size_ && !Fill()) {
+            return false;
+        }
+        out = buffer_[position_++];
+        byte_count_++;
+        return true;
+    }
+
+    // Returns false if the stream ends or fails before `len` bytes are read.
+    // The bytes read until then are still counted by ByteCount().
+    bool ReadBytes(uint8_t* out, size_t len) override {
+        size_t copied = std::min(len, size_ - position_);
+        std::copy(
+                buffer_.data() + position_,
+                buffer_.data() + position_ + copied,
+                out);
+        position_ += copied;
+
+        while (copied < len) {
+            size_t n;
+            if (len - copied >= buffer_.size()) {
+                // Large reads bypass the buffer.
+                n = ReadFromFd(out + copied, len - copied);
+            } else {
+                if (!Fill()) {
+                    break;
+                }
+                n = std::min(len - copied, size_);
+                std::copy(buffer_.data(), buffer_.data() + n, out + copied);
+                position_ = n;
+            }
+            if (n == 0) {
+                break;
+            }
+            copied += n;
+        }
+
+        byte_count_ += copied;
+        return copied == len;
+    }
+
+    // Regular files are skipped with lseek(2) without reading the bytes.
+    // Other files (pipes, sockets) are read and the bytes are discarded.
+    bool Skip(size_t len) override {
+        size_t buffered = std::min(len, size_ - position_);
+        position_ += buffered;
+        byte_count_ += buffered;
+        len -= buffered;
+        if (len == 0) {
+            return true;
+        }
+
+        struct stat st;
+        if (fstat(fd_, &st) == 0 && S_ISREG(st.st_mode)) {
+            off_t current = lseek(fd_, 0, SEEK_CUR);
+            if (current >= 0) {
+                // lseek(2) can go beyond the end of the file, so clamp the
+                // offset to report a short skip.
+                size_t remaining =
+                        st.st_size > current ? st.st_size - current : 0;
+                size_t n = std::min(len, remaining);
+                if (lseek(fd_, n, SEEK_CUR) >= 0) {
+                    byte_count_ += n;
+                    return n == len;
+                }
+            }
+        }
+        return InputStream::Skip(len);
+    }
+
+    // Number of bytes read from the stream.
+    size_t ByteCount() const {
+        return byte_count_;
+    }
+
+    // errno of the last failed read(2), or 0 if the stream simply ended.
+    int GetErrno() const {
+        return errno_;
+    }
+};
+
+// OutputStream which writes into a file descriptor (file, pipe or socket)
+// block by block.
+// The file descriptor isn't closed by the stream.
+//
+// Small writes are buffered. When a write doesn't fit in the buffer, the
+// buffered data and the new data are written together by a single writev(2).
+// Data is flushed when Flush() is called or the stream is destroyed.
+class FdOutputStream : public OutputStream {
+    int fd_;
+    std::vector<uint8_t> buffer_;
+    size_t size_;
+    size_t byte_count_;
+    // errno of the last failed write(2), or 0.
+    int errno_;
+
+    // Writes all of the segments, retrying on EINTR and partial writes.
+    bool WriteFully(struct iovec* iov, int iovcnt) {
+        while (iovcnt > 0) {
+            ssize_t result = writev(fd_, iov, iovcnt);
+            if (result < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                errno_ = errno;
+                return false;
+            }
+            size_t written = result;
+            // Skip the segments which have been written completely.
+            while (iovcnt > 0 && written >= iov->iov_len) {
+                written -= iov->iov_len;
+                iov++;
+                iovcnt--;
+            }
+            if (iovcnt > 0) {
+                iov->iov_base = static_cast<uint8_t*>(iov->iov_base) + written;
+                iov->iov_len -= written;
+            }
+        }
+        return true;
+    }
+
+public:
+    FdOutputStream(int fd, size_t block_size = 65536)
+        : fd_(fd),
+          buffer_(block_size),
+          size_(0),
+          byte_count_(0),
+          errno_(0) {
+    }
+
+    virtual ~FdOutputStream() {
+        Flush();
+    }
+
+    bool Write(uint8_t ch) override {
+        if (size_ >= buffer_.size() && !Flush()) {
+            return false;
+        }
+        buffer_[size_++] = ch;
+        byte_count_++;
+        return true;
+    }
+
+    bool WriteBytes(const uint8_t* data, size_t len) override {
+        if (len <= buffer_.size() - size_) {
+            std::copy(data, data + len, buffer_.data() + size_);
+            size_ += len;
+            byte_count_ += len;
+            return true;
+        }
+
+        struct iovec iov[2];
+        iov[0].iov_base = buffer_.data();
+        iov[0].iov_len = size_;
+        iov[1].iov_base = const_cast<uint8_t*>(data);
+        iov[1].iov_len = len;
+        size_ = 0;
+        if (!WriteFully(iov, 2)) {
+            return false;
+        }
+        byte_count_ += len;
+        return true;
+    }
+
+    // Writes the buffered data into the file descriptor.
+    bool Flush() {
+        if (size_ == 0) {
+            return true;
+        }
+        struct iovec iov;
+        iov.iov_base = buffer_.data();
+        iov.iov_len = size_;
+        size_ = 0;
+        return WriteFully(&iov, 1);
+    }
+
+    // Number of bytes accepted by Write() and WriteBytes(), which matches
+    // OutputStreamWrapper::WrittenSize() of a CodedOutputStream writing into
+    // this stream. Some of them may still be buffered.
+    size_t ByteCount() const {
+        return byte_count_;
+    }
+
+    // errno of the last failed write(2), or 0.
+    int GetErrno() const {
+        return errno_;
+    }
+};
+
+}  // namespace decaproto
+
+#endif  // DECAPROTO_STREAM_FD_STREAM_H
@@ -0,0 +1,135 @@
+#ifndef DECAPROTO_STREAM_MMAP_STREAM_H
+#define DECAPROTO_STREAM_MMAP_STREAM_H
+
+// POSIX only. This header isn't included by the rest of the runtime so that
+// the library still builds on platforms without mmap (e.g. Arduino).
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <string>
+
+#include "decaproto/stream/stream.h"
+
+namespace decaproto {
+
+// InputStream which maps a file into memory and reads it as a flat buffer.
+//
+// CodedInputStream reads the mapped memory directly through
+// GetDirectBuffer(), so decoding a file doesn't involve any read() calls or
+// virtual calls per byte. The kernel pages the file in on demand and is told
+// that we read it sequentially, so files larger than RAM can be decoded as
+// well.
+class MmapInputStream : public InputStream {
+    const uint8_t* data_;
+    size_t size_;
+    size_t position_;
+
+public:
+    MmapInputStream() : data_(nullptr), size_(0), position_(0) {
+    }
+
+    virtual ~MmapInputStream() {
+        Close();
+    }
+
+    MmapInputStream(const MmapInputStream&) = delete;
+    MmapInputStream& operator=(const MmapInputStream&) = delete;
+
+    // Maps the file at `path`.
+    // Returns false if the file can't be opened or mapped.
+    bool Open(const std::string& path) {
+        Close();
+
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            close(fd);
+            return false;
+        }
+        if (st.st_size == 0) {
+            // mmap() doesn't accept an empty range.
+            close(fd);
+            return true;
+        }
+
+        void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        // The mapping stays valid after closing the file.
+        close(fd);
+        if (addr == MAP_FAILED) {
+            return false;
+        }
+        madvise(addr, st.st_size, MADV_SEQUENTIAL);
+
+        data_ = static_cast<const uint8_t*>(addr);
+        size_ = st.st_size;
+        return true;
+    }
+
+    void Close() {
+        if (data_ != nullptr) {
+            munmap(const_cast<uint8_t*>(data_), size_);
+        }
+        data_ = nullptr;
+        size_ = 0;
+        position_ = 0;
+    }
+
+    bool Read(uint8_t& out) override {
+        if (position_ >= size_) {
+            return false;
+        }
+        out = data_[position_++];
+        return true;
+    }
+
+    bool ReadBytes(uint8_t* out, size_t len) override {
+        if (len > size_ - position_) {
+            return false;
+        }
+        if (len > 0) {
+            std::memcpy(out, data_ + position_, len);
+        }
+        position_ += len;
+        return true;
+    }
+
+    bool Skip(size_t len) override {
+        if (len > size_ - position_) {
+            position_ = size_;
+            return false;
+        }
+        position_ += len;
+        return true;
+    }
+
+    bool GetDirectBuffer(const uint8_t*& data, size_t& size) override {
+        data = data_ + position_;
+        size = size_ - position_;
+        return true;
+    }
+
+    void ConsumeDirectBuffer(size_t len) override {
+        position_ += len;
+    }
+
+    // Size of the mapped file.
+    size_t Size() const {
+        return size_;
+    }
+
+    // How many bytes have been read from the file.
+    size_t Position() const {
+        return position_;
+    }
+};
+
+}  // namespace decaproto
+
+#endif  // DECAPROTO_STREAM_MMAP_STREAM_H
@@ -0,0 +1,247 @@
+#ifndef DECAPROTO_STREAM_RING_STREAM_H
+#define DECAPROTO_STREAM_RING_STREAM_H
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+
+#include "decaproto/stream/zero_copy_stream.h"
+
+namespace decaproto {
+
+// Lock-free single-producer/single-consumer ring buffer of bytes.
+//
+// The producer thread writes into the free region and publishes it with
+// Commit(). The consumer thread reads the published region and releases it
+// with Consume(). Both sides publish any number of bytes with a single atomic
+// store, and the two indices live on separate cache lines so that the two
+// threads don't invalidate each other's cache on every access.
+//
+// Use RingOutputStream and RingInputStream to encode into/decode from the
+// buffer.
+class SpscRingBuffer {
+public:
+    static constexpr size_t kCacheLineSize = 64;
+
+    // `capacity` is rounded up to a power of two.
+    SpscRingBuffer(size_t capacity)
+        : capacity_(RoundUpToPowerOfTwo(capacity)),
+          mask_(capacity_ - 1),
+          buffer_(new uint8_t[capacity_]),
+          head_(0),
+          cached_tail_(0),
+          tail_(0),
+          cached_head_(0),
+          closed_(false) {
+    }
+
+    SpscRingBuffer(const SpscRingBuffer&) = delete;
+    SpscRingBuffer& operator=(const SpscRingBuffer&) = delete;
+
+    size_t Capacity() const {
+        return capacity_;
+    }
+
+    // Producer side
+
+    // Sets `data` to the contiguous free region and returns its size.
+    // Returns 0 if the buffer is full.
+    size_t WritableRegion(uint8_t*& data) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        size_t offset = tail & mask_;
+        if (capacity_ - (tail - cached_head_) < capacity_ - offset) {
+            // The region may have grown since we looked at the head last
+            // time.
+            cached_head_ = head_.load(std::memory_order_acquire);
+        }
+        data = buffer_.get() + offset;
+        return std::min(capacity_ - (tail - cached_head_), capacity_ - offset);
+    }
+
+    // Publishes `len` bytes written into the region from WritableRegion().
+    void Commit(size_t len) {
+        if (len > 0) {
+            tail_.store(
+                    tail_.load(std::memory_order_relaxed) + len,
+                    std::memory_order_release);
+        }
+    }
+
+    // Tells the consumer that no more data will be committed.
+    void Close() {
+        closed_.store(true, std::memory_order_release);
+    }
+
+    // Consumer side
+
+    // Sets `data` to the contiguous region of committed data and returns its
+    // size. Returns 0 if the buffer is empty.
+    size_t ReadableRegion(const uint8_t*& data) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        size_t offset = head & mask_;
+        if (cached_tail_ - head < capacity_ - offset) {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+        }
+        data = buffer_.get() + offset;
+        return std::min(cached_tail_ - head, capacity_ - offset);
+    }
+
+    // Releases `len` bytes read from the region from ReadableRegion().
+    void Consume(size_t len) {
+        if (len > 0) {
+            head_.store(
+                    head_.load(std::memory_order_relaxed) + len,
+                    std::memory_order_release);
+        }
+    }
+
+    // True if the producer has closed the buffer and all of the committed
+    // data has been consumed.
+    bool IsDrained() {
+        if (!closed_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        cached_tail_ = tail_.load(std::memory_order_acquire);
+        return cached_tail_ == head_.load(std::memory_order_relaxed);
+    }
+
+private:
+    static size_t RoundUpToPowerOfTwo(size_t value) {
+        size_t result = 1;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    const size_t capacity_;
+    const size_t mask_;
+    std::unique_ptr<uint8_t[]> buffer_;
+
+    // Written by the consumer
+    alignas(kCacheLineSize) std::atomic<size_t> head_;
+    size_t cached_tail_;
+
+    // Written by the producer
+    alignas(kCacheLineSize) std::atomic<size_t> tail_;
+    size_t cached_head_;
+
+    alignas(kCacheLineSize) std::atomic<bool> closed_;
+};
+
+// Producer side of SpscRingBuffer.
+//
+// CodedOutputStream encodes directly into the free region of the ring, and
+// the encoded bytes are published when CodedOutputStream returns the unused
+// part of the region (i.e. when it's destroyed), when it moves on to the next
+// region, or on Flush(). Next() spins while the ring is full.
+class RingOutputStream : public ZeroCopyOutputStream {
+    SpscRingBuffer* ring_;
+    // Size of the region returned by the last Next() which isn't published
+    // yet.
+    size_t pending_;
+    int64_t byte_count_;
+
+public:
+    RingOutputStream(SpscRingBuffer* ring)
+        : ring_(ring), pending_(0), byte_count_(0) {
+    }
+
+    // Closes the ring so that the consumer sees the end of the stream.
+    virtual ~RingOutputStream() {
+        Close();
+    }
+
+    bool Next(void** data, int* size) override {
+        Flush();
+        uint8_t* region;
+        size_t region_size;
+        while ((region_size = ring_->WritableRegion(region)) == 0) {
+            std::this_thread::yield();
+        }
+        pending_ = region_size;
+        byte_count_ += region_size;
+        *data = region;
+        *size = static_cast<int>(region_size);
+        return true;
+    }
+
+    void BackUp(int count) override {
+        pending_ -= count;
+        byte_count_ -= count;
+        Flush();
+    }
+
+    int64_t ByteCount() const override {
+        return byte_count_;
+    }
+
+    // Publishes the bytes written so far.
+    void Flush() {
+        ring_->Commit(pending_);
+        pending_ = 0;
+    }
+
+    void Close() {
+        Flush();
+        ring_->Close();
+    }
+};
+
+// Consumer side of SpscRingBuffer.
+//
+// CodedInputStream decodes directly from the ring, and the region is released
+// when CodedInputStream moves on to the next region or returns the unread
+// part of the region. Next() spins while the ring is empty, and returns false
+// once the producer closes the ring and everything is read.
+class RingInputStream : public ZeroCopyInputStream {
+    SpscRingBuffer* ring_;
+    // Size of the region returned by the last Next() which isn't released
+    // yet.
+    size_t pending_;
+    int64_t byte_count_;
+
+public:
+    RingInputStream(SpscRingBuffer* ring)
+        : ring_(ring), pending_(0), byte_count_(0) {
+    }
+
+    virtual ~RingInputStream() {
+        ring_->Consume(pending_);
+    }
+
+    bool Next(const void** data, int* size) override {
+        ring_->Consume(pending_);
+        pending_ = 0;
+
+        const uint8_t* region;
+        size_t region_size;
+        while ((region_size = ring_->ReadableRegion(region)) == 0) {
+            if (ring_->IsDrained()) {
+                return false;
+            }
+            std::this_thread::yield();
+        }
+        pending_ = region_size;
+        byte_count_ += region_size;
+        *data = region;
+        *size = static_cast<int>(region_size);
+        return true;
+    }
+
+    void BackUp(int count) override {
+        pending_ -= count;
+        byte_count_ -= count;
+        ring_->Consume(pending_);
+        pending_ = 0;
+    }
+
+    int64_t ByteCount() const override {
+        return byte_count_;
+    }
+};
+
+}  // namespace decaproto
+
+#endif  // DECAPROTO_STREAM_RING_STREAM_H
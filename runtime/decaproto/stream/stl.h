@@ -1,9 +1,12 @@
 #ifndef DECAPROTO_STL_H
 #define DECAPROTO_STL_H
 
+#include <algorithm>
 #include <iostream>
+#include <vector>
 
 #include "decaproto/stream/stream.h"
+#include "decaproto/stream/zero_copy_stream.h"
 
 namespace decaproto {
 
@@ -20,6 +23,11 @@ public:
         out = static_cast<std::uint8_t>(c);
         return static_cast<bool>(*stream_);
     }
+
+    bool ReadBytes(std::uint8_t* out, size_t len) override {
+        stream_->read(reinterpret_cast<char*>(out), len);
+        return static_cast<size_t>(stream_->gcount()) == len;
+    }
 };
 
 class StlOutputStream : public OutputStream {
@@ -33,6 +41,235 @@ public:
         stream_->put(ch);
         return stream_;
     }
+
+    bool WriteBytes(const uint8_t* data, size_t len) override {
+        stream_->write(reinterpret_cast<const char*>(data), len);
+        return static_cast<bool>(*stream_);
+    }
+};
+
+// InputStream which reads std::istream block by block through its underlying
+// streambuf instead of calling std::istream::get() per byte.
+//
+// Bytes buffered but not read are returned to the istream by seeking back on
+// destruction if the istream supports it. Otherwise they are lost, so don't
+// read the istream by other ways after using this stream on non-seekable
+// istreams.
+class BufferedStlInputStream : public InputStream {
+    std::istream* stream_;
+    std::vector<char> buffer_;
+    // [position_, size_) of buffer_ hasn't been read yet.
+    size_t position_;
+    size_t size_;
+    // Number of bytes read by the last call to ReadBytes().
+    size_t last_read_size_;
+
+    // Refills the buffer. Returns false if there is no more data.
+    bool Fill() {
+        std::streamsize read_size =
+                stream_->rdbuf()->sgetn(buffer_.data(), buffer_.size());
+        position_ = 0;
+        size_ = read_size > 0 ? read_size : 0;
+        if (size_ == 0) {
+            stream_->setstate(std::ios_base::eofbit);
+            return false;
+        }
+        return true;
+    }
+
+public:
+    BufferedStlInputStream(std::istream* stream, size_t block_size = 16384)
+        : stream_(stream),
+          buffer_(block_size),
+          position_(0),
+          size_(0),
+          last_read_size_(0) {
+    }
+
+    virtual ~BufferedStlInputStream() {
+        if (position_ < size_) {
+            stream_->rdbuf()->pubseekoff(
+                    -static_cast<std::streamoff>(size_ - position_),
+                    std::ios_base::cur,
+                    std::ios_base::in);
+        }
+    }
+
+    bool Read(std::uint8_t& out) override {
+        if (position_ >= size_ && !Fill()) {
+            return false;
+        }
+        out = static_cast<std::uint8_t>(buffer_[position_++]);
+        return true;
+    }
+
+    // Returns false if the stream ends before `len` bytes are read.
+    // The bytes read until then are stored in `out` and the number of them
+    // is available from LastReadSize().
+    bool ReadBytes(std::uint8_t* out, size_t len) override {
+        char* dst = reinterpret_cast<char*>(out);
+        size_t copied = std::min(len, size_ - position_);
+        std::copy(
+                buffer_.data() + position_,
+                buffer_.data() + position_ + copied,
+                dst);
+        position_ += copied;
+
+        if (len - copied >= buffer_.size()) {
+            // Large reads bypass the buffer.
+            std::streamsize read_size =
+                    stream_->rdbuf()->sgetn(dst + copied, len - copied);
+            copied += read_size > 0 ? read_size : 0;
+        } else {
+            while (copied < len && Fill()) {
+                size_t n = std::min(len - copied, size_);
+                std::copy(buffer_.data(), buffer_.data() + n, dst + copied);
+                position_ = n;
+                copied += n;
+            }
+        }
+
+        last_read_size_ = copied;
+        if (copied < len) {
+            stream_->setstate(std::ios_base::eofbit);
+            return false;
+        }
+        return true;
+    }
+
+    size_t LastReadSize() const {
+        return last_read_size_;
+    }
+};
+
+// OutputStream which writes std::ostream block by block through its underlying
+// streambuf instead of calling std::ostream::put() per byte.
+//
+// Data is buffered until the buffer gets full, Flush() is called, or the
+// stream is destroyed.
+class BufferedStlOutputStream : public OutputStream {
+    std::ostream* stream_;
+    std::vector<char> buffer_;
+    size_t size_;
+
+    bool WriteToStream(const char* data, size_t len) {
+        std::streamsize written = stream_->rdbuf()->sputn(
+                data, static_cast<std::streamsize>(len));
+        if (written != static_cast<std::streamsize>(len)) {
+            stream_->setstate(std::ios_base::badbit);
+            return false;
+        }
+        return true;
+    }
+
+public:
+    BufferedStlOutputStream(std::ostream* stream, size_t block_size = 16384)
+        : stream_(stream), buffer_(block_size), size_(0) {
+    }
+
+    virtual ~BufferedStlOutputStream() {
+        Flush();
+    }
+
+    bool Write(uint8_t ch) override {
+        if (size_ >= buffer_.size() && !Flush()) {
+            return false;
+        }
+        buffer_[size_++] = static_cast<char>(ch);
+        return true;
+    }
+
+    bool WriteBytes(const uint8_t* data, size_t len) override {
+        const char* src = reinterpret_cast<const char*>(data);
+        if (len > buffer_.size() - size_) {
+            if (!Flush()) {
+                return false;
+            }
+            if (len >= buffer_.size()) {
+                // Large writes bypass the buffer.
+                return WriteToStream(src, len);
+            }
+        }
+        std::copy(src, src + len, buffer_.data() + size_);
+        size_ += len;
+        return true;
+    }
+
+    // Writes the buffered data to the underlying streambuf.
+    // Returns false if the streambuf doesn't accept all of them.
+    bool Flush() {
+        if (size_ == 0) {
+            return true;
+        }
+        size_t size = size_;
+        size_ = 0;
+        return WriteToStream(buffer_.data(), size);
+    }
+};
+
+// Reads std::istream block by block through its underlying streambuf.
+//
+// Bytes backed up at the end of reading are returned to the istream by
+// seeking back if the istream supports it. Otherwise they are lost, so don't
+// read the istream by other ways after using this stream on non-seekable
+// istreams.
+class StlZeroCopyInputStream : public ZeroCopyInputStream {
+    std::istream* stream_;
+    std::vector<char> buffer_;
+    // Size of the data in buffer_
+    size_t buffer_used_;
+    // Size of the data at the end of buffer_ which has been backed up
+    size_t backed_up_;
+    int64_t byte_count_;
+
+public:
+    StlZeroCopyInputStream(std::istream* stream, size_t block_size = 4096)
+        : stream_(stream),
+          buffer_(block_size),
+          buffer_used_(0),
+          backed_up_(0),
+          byte_count_(0) {
+    }
+
+    virtual ~StlZeroCopyInputStream() {
+        if (backed_up_ > 0) {
+            stream_->rdbuf()->pubseekoff(
+                    -static_cast<std::streamoff>(backed_up_),
+                    std::ios_base::cur,
+                    std::ios_base::in);
+        }
+    }
+
+    bool Next(const void** data, int* size) override {
+        if (backed_up_ > 0) {
+            *data = buffer_.data() + buffer_used_ - backed_up_;
+            *size = static_cast<int>(backed_up_);
+            byte_count_ += backed_up_;
+            backed_up_ = 0;
+            return true;
+        }
+
+        std::streamsize read_size =
+                stream_->rdbuf()->sgetn(buffer_.data(), buffer_.size());
+        if (read_size <= 0) {
+            stream_->setstate(std::ios_base::eofbit);
+            return false;
+        }
+        buffer_used_ = read_size;
+        *data = buffer_.data();
+        *size = static_cast<int>(read_size);
+        byte_count_ += read_size;
+        return true;
+    }
+
+    void BackUp(int count) override {
+        backed_up_ += count;
+        byte_count_ -= count;
+    }
+
+    int64_t ByteCount() const override {
+        return byte_count_;
+    }
 };
 
 }  // namespace decaproto
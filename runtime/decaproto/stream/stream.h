@@ -1,6 +1,7 @@
 #ifndef DECAPROTO_STREAM_STREAM_H
 #define DECAPROTO_STREAM_STREAM_H
 
+#include <cstddef>
 #include <cstdint>
 
 namespace decaproto {
@@ -14,6 +15,54 @@ public:
     }
 
     virtual bool Read(uint8_t& out) = 0;
+
+    // Reads exactly `len` bytes into `out`.
+    // Returns false if the stream ends before `len` bytes are read.
+    //
+    // The default implementation calls Read() for each byte. Streams which can
+    // read a block of bytes at once should override it.
+    virtual bool ReadBytes(uint8_t* out, size_t len) {
+        for (size_t i = 0; i < len; i++) {
+            if (!Read(out[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Skips `len` bytes.
+    // Returns false if the stream ends before `len` bytes are skipped.
+    //
+    // The default implementation reads the bytes into a small buffer with
+    // ReadBytes(). Streams which can seek should override it to skip in
+    // constant time.
+    virtual bool Skip(size_t len) {
+        uint8_t buf[64];
+        while (len > 0) {
+            size_t n = len < sizeof(buf) ? len : sizeof(buf);
+            if (!ReadBytes(buf, n)) {
+                return false;
+            }
+            len -= n;
+        }
+        return true;
+    }
+
+    // Streams backed by a contiguous memory region can expose it so that
+    // CodedInputStream reads the bytes directly without calling Read().
+    //
+    // Returns true and sets `data` and `size` to the unread part of the
+    // buffer if the stream supports it. The reader must report how many bytes
+    // it has consumed through ConsumeDirectBuffer() before using the stream
+    // in any other way.
+    virtual bool GetDirectBuffer(
+            const uint8_t*& /* data */, size_t& /* size */) {
+        return false;
+    }
+
+    // Marks `len` bytes of the buffer returned by GetDirectBuffer() as read.
+    virtual void ConsumeDirectBuffer(size_t /* len */) {
+    }
 };
 
 class OutputStream {
@@ -24,6 +73,35 @@ public:
     }
 
     virtual bool Write(uint8_t ch) = 0;
+
+    // Writes `len` bytes from `data`.
+    //
+    // The default implementation calls Write() for each byte. Streams which
+    // can write a block of bytes at once should override it.
+    virtual bool WriteBytes(const uint8_t* data, size_t len) {
+        for (size_t i = 0; i < len; i++) {
+            if (!Write(data[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Streams backed by a contiguous memory region can expose it so that
+    // CodedOutputStream writes the bytes directly without calling Write().
+    //
+    // Returns true and sets `data` and `size` to the writable part of the
+    // buffer if the stream supports it. The writer must report how many bytes
+    // it has written through CommitDirectBuffer() before using the stream in
+    // any other way.
+    virtual bool GetDirectBuffer(uint8_t*& /* data */, size_t& /* size */) {
+        return false;
+    }
+
+    // Marks `len` bytes of the buffer returned by GetDirectBuffer() as
+    // written.
+    virtual void CommitDirectBuffer(size_t /* len */) {
+    }
 };
 
 }  // namespace decaproto
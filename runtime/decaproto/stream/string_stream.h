@@ -19,6 +19,11 @@ namespace decaproto {
             str_->push_back(ch);
             return true;
         }
+
+        virtual bool WriteBytes(const uint8_t* data, size_t len) {
+            str_->append(reinterpret_cast<const char*>(data), len);
+            return true;
+        }
     };
 }
 
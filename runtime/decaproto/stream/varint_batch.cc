@@ -0,0 +1,329 @@
+#include "decaproto/stream/varint_batch.h"
+
+#include <algorithm>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define DECAPROTO_VARINT_BATCH_X86 1
+#include <immintrin.h>
+
+#include <cstring>
+#endif
+
+namespace decaproto {
+
+namespace {
+
+const size_t kMaxVarintSize = 10;
+
+template <typename T>
+inline T ZigZag(uint64_t value);
+
+template <>
+inline uint32_t ZigZag<uint32_t>(uint64_t value) {
+    uint32_t v = static_cast<uint32_t>(value);
+    return (v >> 1) ^ -(v & 1);
+}
+
+template <>
+inline uint64_t ZigZag<uint64_t>(uint64_t value) {
+    return (value >> 1) ^ -(value & 1);
+}
+
+template <typename T>
+inline T Convert(uint64_t value, bool zigzag) {
+    return zigzag ? ZigZag<T>(value) : static_cast<T>(value);
+}
+
+// Decodes the varints in [p, end) one by one.
+// On success, `p` is moved to `end` and `out` to the end of the output.
+template <typename T>
+bool DecodeScalar(
+        const uint8_t*& p, const uint8_t* end, T*& out, bool zigzag) {
+    while (p < end) {
+        uint64_t b = *p++;
+        if (b < 0x80) {
+            *out++ = Convert<T>(b, zigzag);
+            continue;
+        }
+        uint64_t value = b & 0x7f;
+        for (uint32_t shift = 7;; shift += 7) {
+            if (p == end || shift >= 64) {
+                // Truncated or too long
+                return false;
+            }
+            b = *p++;
+            value |= (b & 0x7f) << shift;
+            if (b < 0x80) {
+                break;
+            }
+        }
+        *out++ = Convert<T>(value, zigzag);
+    }
+    return true;
+}
+
+#ifdef DECAPROTO_VARINT_BATCH_X86
+
+// Assembles a varint of `len` (<= 10) bytes starting from `p`, which must be
+// readable for 10 bytes. The 7-bit groups of the first 8 bytes are packed
+// with a few shifts and masks instead of a loop over the bytes.
+inline uint64_t AssembleVarint(const uint8_t* p, uint32_t len) {
+    uint64_t x;
+    std::memcpy(&x, p, sizeof(x));
+    // Drop the bytes after the varint without a branch.
+    x &= ~0ULL >> (64 - 8 * std::min<uint32_t>(len, 8));
+    x = (x & 0x007f007f007f007fULL) | ((x & 0x7f007f007f007f00ULL) >> 1);
+    x = (x & 0x00003fff00003fffULL) | ((x & 0x3fff00003fff0000ULL) >> 2);
+    x = (x & 0x000000000fffffffULL) | ((x & 0x0fffffff00000000ULL) >> 4);
+    if (len > 8) {
+        x |= static_cast<uint64_t>(p[8] & 0x7f) << 56;
+        if (len > 9) {
+            x |= static_cast<uint64_t>(p[9]) << 63;
+        }
+    }
+    return x;
+}
+
+// Handles a block of `kBlockSize` bytes starting from `cur` which contains a
+// multi-byte varint. Bits of `mask` are the continuation bits of the bytes.
+//
+// The caller has already widened the whole block as if it were made of
+// one-byte varints, so the values before the first continuation bit are
+// correct. We keep them, and decode the varint after them from the mask.
+// The rest of the block is left for the next iteration.
+//
+// AssembleVarint must be able to read 10 bytes after the block.
+template <typename T, uint32_t kBlockSize>
+inline bool DecodeMixedBlock(
+        const uint8_t*& cur, uint32_t mask, T*& dst, bool zigzag) {
+    uint32_t ones = __builtin_ctz(mask);
+    cur += ones;
+    dst += ones;
+
+    // Bits set at the last byte of each varint in the rest of the block
+    uint32_t ends = ~(mask >> ones) & (~0U >> (32 - kBlockSize + ones));
+    if (ends == 0) {
+        // The varint continues to the next block. If it started at the
+        // beginning of the block, it's longer than any valid varint.
+        return ones > 0;
+    }
+    uint32_t len = __builtin_ctz(ends) + 1;
+    if (len > kMaxVarintSize) {
+        return false;
+    }
+    *dst++ = Convert<T>(AssembleVarint(cur, len), zigzag);
+    cur += len;
+    return true;
+}
+
+__attribute__((target("sse4.1"))) inline __m128i ZigZag32x4(__m128i v) {
+    __m128i sign = _mm_sub_epi32(
+            _mm_setzero_si128(), _mm_and_si128(v, _mm_set1_epi32(1)));
+    return _mm_xor_si128(_mm_srli_epi32(v, 1), sign);
+}
+
+__attribute__((target("sse4.1"))) inline __m128i ZigZag64x2(__m128i v) {
+    __m128i sign = _mm_sub_epi64(
+            _mm_setzero_si128(), _mm_and_si128(v, _mm_set1_epi64x(1)));
+    return _mm_xor_si128(_mm_srli_epi64(v, 1), sign);
+}
+
+// Widens 16 one-byte varints to 16 values.
+__attribute__((target("sse4.1"))) inline void WidenSse41(
+        __m128i bytes, uint32_t* out, bool zigzag) {
+    for (int i = 0; i < 4; i++) {
+        __m128i v = _mm_cvtepu8_epi32(bytes);
+        if (zigzag) {
+            v = ZigZag32x4(v);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 4), v);
+        bytes = _mm_srli_si128(bytes, 4);
+    }
+}
+
+__attribute__((target("sse4.1"))) inline void WidenSse41(
+        __m128i bytes, uint64_t* out, bool zigzag) {
+    for (int i = 0; i < 8; i++) {
+        __m128i v = _mm_cvtepu8_epi64(bytes);
+        if (zigzag) {
+            v = ZigZag64x2(v);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 2), v);
+        bytes = _mm_srli_si128(bytes, 2);
+    }
+}
+
+template <typename T>
+__attribute__((target("sse4.1"))) bool DecodeSse41(
+        const uint8_t*& p, const uint8_t* end, T*& out, bool zigzag) {
+    // Keep the pointers in registers rather than updating them through the
+    // references.
+    const uint8_t* cur = p;
+    T* dst = out;
+    bool ok = true;
+    // Leave enough bytes after the block for AssembleVarint.
+    while (end - cur >= static_cast<ptrdiff_t>(16 + kMaxVarintSize)) {
+        __m128i bytes =
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(cur));
+        uint32_t mask = _mm_movemask_epi8(bytes);
+        // Widen the bytes even if some varints are longer. The values of
+        // the leading one-byte varints are still valid.
+        WidenSse41(bytes, dst, zigzag);
+        if (mask == 0) {
+            cur += 16;
+            dst += 16;
+        } else if (!DecodeMixedBlock<T, 16>(cur, mask, dst, zigzag)) {
+            ok = false;
+            break;
+        }
+    }
+    p = cur;
+    out = dst;
+    return ok && DecodeScalar(p, end, out, zigzag);
+}
+
+__attribute__((target("avx2"))) inline __m256i ZigZag32x8(__m256i v) {
+    __m256i sign = _mm256_sub_epi32(
+            _mm256_setzero_si256(),
+            _mm256_and_si256(v, _mm256_set1_epi32(1)));
+    return _mm256_xor_si256(_mm256_srli_epi32(v, 1), sign);
+}
+
+__attribute__((target("avx2"))) inline __m256i ZigZag64x4(__m256i v) {
+    __m256i sign = _mm256_sub_epi64(
+            _mm256_setzero_si256(),
+            _mm256_and_si256(v, _mm256_set1_epi64x(1)));
+    return _mm256_xor_si256(_mm256_srli_epi64(v, 1), sign);
+}
+
+// Widens 16 one-byte varints to 16 values.
+__attribute__((target("avx2"))) inline void WidenAvx2(
+        __m128i bytes, uint32_t* out, bool zigzag) {
+    for (int i = 0; i < 2; i++) {
+        __m256i v = _mm256_cvtepu8_epi32(bytes);
+        if (zigzag) {
+            v = ZigZag32x8(v);
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i * 8), v);
+        bytes = _mm_srli_si128(bytes, 8);
+    }
+}
+
+__attribute__((target("avx2"))) inline void WidenAvx2(
+        __m128i bytes, uint64_t* out, bool zigzag) {
+    for (int i = 0; i < 4; i++) {
+        __m256i v = _mm256_cvtepu8_epi64(bytes);
+        if (zigzag) {
+            v = ZigZag64x4(v);
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i * 4), v);
+        bytes = _mm_srli_si128(bytes, 4);
+    }
+}
+
+template <typename T>
+__attribute__((target("avx2"))) bool DecodeAvx2(
+        const uint8_t*& p, const uint8_t* end, T*& out, bool zigzag) {
+    const uint8_t* cur = p;
+    T* dst = out;
+    bool ok = true;
+    while (end - cur >= static_cast<ptrdiff_t>(32 + kMaxVarintSize)) {
+        __m256i bytes =
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(cur));
+        uint32_t mask = _mm256_movemask_epi8(bytes);
+        WidenAvx2(_mm256_castsi256_si128(bytes), dst, zigzag);
+        WidenAvx2(_mm256_extracti128_si256(bytes, 1), dst + 16, zigzag);
+        if (mask == 0) {
+            cur += 32;
+            dst += 32;
+        } else if (!DecodeMixedBlock<T, 32>(cur, mask, dst, zigzag)) {
+            ok = false;
+            break;
+        }
+    }
+    p = cur;
+    out = dst;
+    return ok && DecodeScalar(p, end, out, zigzag);
+}
+
+#endif  // DECAPROTO_VARINT_BATCH_X86
+
+VarintBatchKernel DetectKernel() {
+#ifdef DECAPROTO_VARINT_BATCH_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return kVarintBatchAvx2;
+    }
+    if (__builtin_cpu_supports("sse4.1")) {
+        return kVarintBatchSse41;
+    }
+#endif
+    return kVarintBatchScalar;
+}
+
+VarintBatchKernel& ActiveKernel() {
+    static VarintBatchKernel kernel = GetVarintBatchKernel();
+    return kernel;
+}
+
+template <typename T>
+bool Decode(
+        const uint8_t* data,
+        size_t size,
+        std::vector<T>& result,
+        bool zigzag) {
+    // Each varint takes at least one byte.
+    size_t old_size = result.size();
+    result.resize(old_size + size);
+
+    const uint8_t* p = data;
+    const uint8_t* end = data + size;
+    T* out = result.data() + old_size;
+    bool ok;
+    switch (ActiveKernel()) {
+#ifdef DECAPROTO_VARINT_BATCH_X86
+        case kVarintBatchAvx2:
+            ok = DecodeAvx2(p, end, out, zigzag);
+            break;
+        case kVarintBatchSse41:
+            ok = DecodeSse41(p, end, out, zigzag);
+            break;
+#endif
+        default:
+            ok = DecodeScalar(p, end, out, zigzag);
+            break;
+    }
+    result.resize(out - result.data());
+    return ok;
+}
+
+}  // namespace
+
+bool DecodeVarintBatch(
+        const uint8_t* data,
+        size_t size,
+        std::vector<uint32_t>& out,
+        bool zigzag) {
+    return Decode(data, size, out, zigzag);
+}
+
+bool DecodeVarintBatch(
+        const uint8_t* data,
+        size_t size,
+        std::vector<uint64_t>& out,
+        bool zigzag) {
+    return Decode(data, size, out, zigzag);
+}
+
+VarintBatchKernel GetVarintBatchKernel() {
+    static VarintBatchKernel kernel = DetectKernel();
+    return kernel;
+}
+
+void SetVarintBatchKernel(VarintBatchKernel kernel) {
+    if (kernel <= GetVarintBatchKernel()) {
+        ActiveKernel() = kernel;
+    }
+}
+
+}  // namespace decaproto
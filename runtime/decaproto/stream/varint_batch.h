@@ -0,0 +1,53 @@
+#ifndef DECAPROTO_STREAM_VARINT_BATCH_H
+#define DECAPROTO_STREAM_VARINT_BATCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace decaproto {
+
+// Decodes a run of consecutive varints (e.g. the payload of a packed repeated
+// field) and appends them to `out`.
+//
+// The whole run is decoded in one pass. On x86 CPUs supporting SSE4.1 or
+// AVX2 (detected at runtime), the continuation bits of 16 or 32 bytes are
+// checked at once. Runs of one-byte varints, which are common for sensor
+// values and enums, are widened with vector instructions, and a multi-byte
+// varint after them is assembled from the bytes the bit mask tells.
+// Otherwise, a scalar loop is used.
+//
+// If `zigzag` is true, the values are ZigZag-decoded (sint32/sint64).
+// Values are truncated to the element type, since negative int32 values are
+// encoded as 10-byte varints.
+//
+// Returns false if `data` doesn't end at the end of a varint or a varint is
+// longer than 10 bytes. Values decoded before the error are left in `out`.
+bool DecodeVarintBatch(
+        const uint8_t* data,
+        size_t size,
+        std::vector<uint32_t>& out,
+        bool zigzag = false);
+bool DecodeVarintBatch(
+        const uint8_t* data,
+        size_t size,
+        std::vector<uint64_t>& out,
+        bool zigzag = false);
+
+// Instruction sets DecodeVarintBatch can use.
+enum VarintBatchKernel {
+    kVarintBatchScalar,
+    kVarintBatchSse41,
+    kVarintBatchAvx2,
+};
+
+// The best kernel supported by the running CPU.
+VarintBatchKernel GetVarintBatchKernel();
+
+// Forces DecodeVarintBatch to use `kernel` (e.g. to compare the kernels in
+// benchmarks). Kernels the CPU doesn't support are ignored.
+void SetVarintBatchKernel(VarintBatchKernel kernel);
+
+}  // namespace decaproto
+
+#endif  // DECAPROTO_STREAM_VARINT_BATCH_H
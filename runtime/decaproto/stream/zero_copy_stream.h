@@ -0,0 +1,206 @@
+#ifndef DECAPROTO_STREAM_ZERO_COPY_STREAM_H
+#define DECAPROTO_STREAM_ZERO_COPY_STREAM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace decaproto {
+
+// Stream interface which provides data chunk by chunk instead of byte by byte.
+//
+// CodedInputStream reads each chunk through a raw pointer and calls Next()
+// only when the chunk is exhausted, so that a stream made of several buffers
+// (e.g. a chain of network buffers) can be decoded without copying them into
+// one buffer or calling a virtual function per byte.
+class ZeroCopyInputStream {
+public:
+    ZeroCopyInputStream() {
+    }
+    virtual ~ZeroCopyInputStream() {
+    }
+
+    // Obtains the next chunk of data.
+    // Returns false if there is no more data. Otherwise, sets `data` and
+    // `size` to the chunk, which stays valid until the next call to the
+    // stream. `size` can be 0.
+    virtual bool Next(const void** data, int* size) = 0;
+
+    // Backs up `count` bytes of the last chunk returned by Next() so that they
+    // are returned again by the following Next().
+    // `count` must not be larger than the size of the last chunk.
+    virtual void BackUp(int count) = 0;
+
+    // Total number of bytes returned by Next() minus bytes backed up.
+    virtual int64_t ByteCount() const = 0;
+};
+
+// Output counterpart of ZeroCopyInputStream.
+class ZeroCopyOutputStream {
+public:
+    ZeroCopyOutputStream() {
+    }
+    virtual ~ZeroCopyOutputStream() {
+    }
+
+    // Obtains the next buffer to write into.
+    // Returns false if no more data can be written. Otherwise, sets `data`
+    // and `size` to the buffer. The whole buffer is considered written unless
+    // the unused part is returned by BackUp().
+    virtual bool Next(void** data, int* size) = 0;
+
+    // Returns `count` bytes at the end of the last buffer returned by Next()
+    // as unused.
+    virtual void BackUp(int count) = 0;
+
+    // Total number of bytes written.
+    virtual int64_t ByteCount() const = 0;
+};
+
+// Reads a std::string chunk by chunk.
+// The string must outlive the stream.
+class StringZeroCopyInputStream : public ZeroCopyInputStream {
+    const std::string* str_;
+    size_t block_size_;
+    size_t position_;
+
+public:
+    // `block_size` limits the size of each chunk. The whole string is returned
+    // at once by default.
+    StringZeroCopyInputStream(const std::string* str, size_t block_size = 0)
+        : str_(str), block_size_(block_size), position_(0) {
+    }
+
+    virtual ~StringZeroCopyInputStream() {
+    }
+
+    bool Next(const void** data, int* size) override {
+        if (position_ >= str_->size()) {
+            return false;
+        }
+        size_t chunk_size = str_->size() - position_;
+        if (block_size_ > 0 && chunk_size > block_size_) {
+            chunk_size = block_size_;
+        }
+        *data = str_->data() + position_;
+        *size = static_cast<int>(chunk_size);
+        position_ += chunk_size;
+        return true;
+    }
+
+    void BackUp(int count) override {
+        position_ -= count;
+    }
+
+    int64_t ByteCount() const override {
+        return position_;
+    }
+};
+
+// Appends data to a std::string.
+// The string grows by chunks and the unused part of the last chunk is trimmed
+// when the writer backs it up.
+class StringZeroCopyOutputStream : public ZeroCopyOutputStream {
+    static constexpr size_t kMinimumChunkSize = 16;
+
+    std::string* str_;
+    size_t start_size_;
+
+public:
+    StringZeroCopyOutputStream(std::string* str)
+        : str_(str), start_size_(str->size()) {
+    }
+
+    virtual ~StringZeroCopyOutputStream() {
+    }
+
+    bool Next(void** data, int* size) override {
+        size_t old_size = str_->size();
+        // Double the size of the string so that we don't call Next() too many
+        // times for large messages.
+        size_t chunk_size =
+                old_size < kMinimumChunkSize ? kMinimumChunkSize : old_size;
+        str_->resize(old_size + chunk_size);
+        *data = &(*str_)[old_size];
+        *size = static_cast<int>(chunk_size);
+        return true;
+    }
+
+    void BackUp(int count) override {
+        str_->resize(str_->size() - count);
+    }
+
+    int64_t ByteCount() const override {
+        return str_->size() - start_size_;
+    }
+};
+
+// Reads a list of memory blocks (e.g. a chain of fixed-size network buffers)
+// as one stream.
+// The blocks must outlive the stream.
+class BlockListInputStream : public ZeroCopyInputStream {
+public:
+    struct Block {
+        const uint8_t* data;
+        size_t size;
+    };
+
+private:
+    std::vector<Block> blocks_;
+    // The block we are reading and the read position in it.
+    size_t index_;
+    size_t offset_;
+    int64_t byte_count_;
+
+public:
+    BlockListInputStream(const std::vector<Block>& blocks)
+        : blocks_(blocks), index_(0), offset_(0), byte_count_(0) {
+    }
+
+    // `block_count` blocks of `block_size` bytes each.
+    // The last block can be shorter than the others.
+    BlockListInputStream(
+            const uint8_t* const* blocks,
+            size_t block_count,
+            size_t block_size,
+            size_t last_block_size)
+        : index_(0), offset_(0), byte_count_(0) {
+        for (size_t i = 0; i < block_count; i++) {
+            size_t size = i + 1 == block_count ? last_block_size : block_size;
+            blocks_.push_back(Block{blocks[i], size});
+        }
+    }
+
+    virtual ~BlockListInputStream() {
+    }
+
+    bool Next(const void** data, int* size) override {
+        while (index_ < blocks_.size() && offset_ >= blocks_[index_].size) {
+            index_++;
+            offset_ = 0;
+        }
+        if (index_ >= blocks_.size()) {
+            return false;
+        }
+        const Block& block = blocks_[index_];
+        *data = block.data + offset_;
+        *size = static_cast<int>(block.size - offset_);
+        byte_count_ += block.size - offset_;
+        offset_ = block.size;
+        return true;
+    }
+
+    void BackUp(int count) override {
+        offset_ -= count;
+        byte_count_ -= count;
+    }
+
+    int64_t ByteCount() const override {
+        return byte_count_;
+    }
+};
+
+}  // namespace decaproto
+
+#endif  // DECAPROTO_STREAM_ZERO_COPY_STREAM_H
@@ -0,0 +1,316 @@
+#include "decaproto/table_parser.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "decaproto/decoder.h"
+#include "decaproto/encoder.h"
+
+using namespace std;
+
+namespace decaproto {
+
+namespace {
+
+inline uint8_t* FieldPtr(void* message, uint32_t offset) {
+    return static_cast<uint8_t*>(message) + offset;
+}
+
+template <typename T>
+void Store(void* message, const TableField& field, T value) {
+    uint8_t* holder = FieldPtr(message, field.offset);
+    if (field.repeated) {
+        reinterpret_cast<vector<T>*>(holder)->push_back(value);
+    } else {
+        *reinterpret_cast<T*>(holder) = value;
+    }
+}
+
+// Generated enums are declared as `enum X : int`, so the value is copied
+// into the enum object instead of being stored as an int.
+void StoreEnum(void* message, const TableField& field, int value) {
+    void* dst = field.repeated ? field.mutable_field(message)
+                               : FieldPtr(message, field.offset);
+    memcpy(dst, &value, sizeof(value));
+}
+
+// Finds the field with `number`. Fields usually arrive in the order of their
+// numbers, so the field found last and the one after it are tried before
+// searching the whole table.
+const TableField* FindField(
+        const ParseTable& table, uint32_t number, uint32_t& hint) {
+    for (uint32_t i = hint; i < table.num_fields && i <= hint + 1; i++) {
+        if (table.fields[i].number == number) {
+            hint = i;
+            return &table.fields[i];
+        }
+    }
+    const TableField* end = table.fields + table.num_fields;
+    const TableField* found = lower_bound(
+            table.fields, end, number, [](const TableField& f, uint32_t n) {
+                return f.number < n;
+            });
+    if (found == end || found->number != number) {
+        return nullptr;
+    }
+    hint = found - table.fields;
+    return found;
+}
+
+bool ParseVarint(
+        CodedInputStream& cis, const TableField& field, void* message) {
+    uint64_t value;
+    if (!cis.ReadVarint64(value)) {
+        return false;
+    }
+    switch (field.type) {
+        case kInt32:
+            Store(message, field, static_cast<int32_t>(value));
+            return true;
+        case kInt64:
+            Store(message, field, static_cast<int64_t>(value));
+            return true;
+        case kUint32:
+            Store(message, field, static_cast<uint32_t>(value));
+            return true;
+        case kUint64:
+            Store(message, field, value);
+            return true;
+        case kSint32:
+            Store(message,
+                  field,
+                  CodedInputStream::DecodeZigZag32(
+                          static_cast<uint32_t>(value)));
+            return true;
+        case kSint64:
+            Store(message, field, CodedInputStream::DecodeZigZag64(value));
+            return true;
+        case kBool:
+            Store(message, field, value != 0);
+            return true;
+        case kEnum:
+            StoreEnum(message, field, static_cast<int>(value));
+            return true;
+        default:
+            cerr << "This field is not a varint field. tag: " << field.number
+                 << endl;
+            return false;
+    }
+}
+
+bool ParseFixedInt32(
+        CodedInputStream& cis, const TableField& field, void* message) {
+    uint32_t value;
+    if (!cis.ReadFixedInt32(value)) {
+        return false;
+    }
+    switch (field.type) {
+        case kFixed32:
+            Store(message, field, value);
+            return true;
+        case kSfixed32:
+            Store(message, field, static_cast<int32_t>(value));
+            return true;
+        case kFloat:
+            Store(message, field, MemcpyCast<uint32_t, float>(value));
+            return true;
+        default:
+            cerr << "This field is not a fixed int32 field. tag: "
+                 << field.number << endl;
+            return false;
+    }
+}
+
+bool ParseFixedInt64(
+        CodedInputStream& cis, const TableField& field, void* message) {
+    uint64_t value;
+    if (!cis.ReadFixedInt64(value)) {
+        return false;
+    }
+    switch (field.type) {
+        case kFixed64:
+            Store(message, field, value);
+            return true;
+        case kSfixed64:
+            Store(message, field, static_cast<int64_t>(value));
+            return true;
+        case kDouble:
+            Store(message, field, MemcpyCast<uint64_t, double>(value));
+            return true;
+        default:
+            cerr << "This field is not a fixed int64 field. tag: "
+                 << field.number << endl;
+            return false;
+    }
+}
+
+bool ParseLenPrefix(
+        CodedInputStream& cis, const TableField& field, void* message) {
+    uint32_t size;
+    if (!cis.ReadVarint32(size)) {
+        return false;
+    }
+    switch (field.type) {
+        case kString: {
+            uint8_t* holder = FieldPtr(message, field.offset);
+            if (field.repeated) {
+                vector<string>* values =
+                        reinterpret_cast<vector<string>*>(holder);
+                values->emplace_back();
+                return cis.ReadString(values->back(), size);
+            }
+            string* value = reinterpret_cast<string*>(holder);
+            string_view* view = reinterpret_cast<string_view*>(
+                    FieldPtr(message, field.view_offset));
+            if (cis.AliasingEnabled() && cis.ReadStringView(*view, size)) {
+                value->clear();
+                return true;
+            }
+            *view = string_view();
+            return cis.ReadString(*value, size);
+        }
+        case kMessage: {
+            void* sub_message = field.mutable_field(message);
+            if (!cis.PushLimit(size)) {
+                cerr << "The message exceeds the enclosing message. size: "
+                     << size << ", remaining: " << cis.BytesUntilLimit()
+                     << endl;
+                return false;
+            }
+            bool result = ParseWithTable(cis, *field.sub_table, sub_message);
+            cis.PopLimit();
+            return result;
+        }
+        default:
+            cerr << "This field is not a len-prefix field. tag: "
+                 << field.number << ", field type: " << field.type << endl;
+            return false;
+    }
+}
+
+template <typename T>
+inline vector<T>& Holder(void* message, const TableField& field) {
+    return *reinterpret_cast<vector<T>*>(FieldPtr(message, field.offset));
+}
+
+// Decodes the values of a packed repeated field and appends them to its
+// holder at once.
+bool ParsePacked(
+        CodedInputStream& cis, const TableField& field, void* message) {
+    uint32_t size;
+    if (!cis.ReadVarint32(size)) {
+        return false;
+    }
+    switch (field.type) {
+        case kInt32:
+            return cis.ReadVarintArray(Holder<int32_t>(message, field), size);
+        case kInt64:
+            return cis.ReadVarintArray(Holder<int64_t>(message, field), size);
+        case kUint32:
+            return cis.ReadVarintArray(Holder<uint32_t>(message, field), size);
+        case kUint64:
+            return cis.ReadVarintArray(Holder<uint64_t>(message, field), size);
+        case kSint32:
+            return cis.ReadVarintArray(
+                    Holder<int32_t>(message, field), size, true);
+        case kSint64:
+            return cis.ReadVarintArray(
+                    Holder<int64_t>(message, field), size, true);
+        case kBool:
+            return cis.ReadVarintArray(Holder<bool>(message, field), size);
+        case kEnum: {
+            // The holder is a vector of the generated enum, so the values are
+            // added one by one.
+            vector<int> values;
+            if (!cis.ReadVarintArray(values, size)) {
+                return false;
+            }
+            for (int value : values) {
+                StoreEnum(message, field, value);
+            }
+            return true;
+        }
+        case kFixed32:
+            return cis.ReadFixedArray(Holder<uint32_t>(message, field), size);
+        case kSfixed32:
+            return cis.ReadFixedArray(Holder<int32_t>(message, field), size);
+        case kFloat:
+            return cis.ReadFixedArray(Holder<float>(message, field), size);
+        case kFixed64:
+            return cis.ReadFixedArray(Holder<uint64_t>(message, field), size);
+        case kSfixed64:
+            return cis.ReadFixedArray(Holder<int64_t>(message, field), size);
+        case kDouble:
+            return cis.ReadFixedArray(Holder<double>(message, field), size);
+        default:
+            cerr << "This field can't be packed. tag: " << field.number
+                 << ", field type: " << field.type << endl;
+            return false;
+    }
+}
+
+}  // namespace
+
+bool ParseWithTable(
+        CodedInputStream& cis, const ParseTable& table, void* message) {
+    uint32_t hint = 0;
+    uint32_t tag;
+    while (!cis.ReachedLimit()) {
+        if (!cis.ReadVarint32(tag)) {
+            // The stream ended. It's fine only if the message isn't sized,
+            // otherwise the data is truncated.
+            return cis.BytesUntilLimit() == SIZE_MAX;
+        }
+        WireType wire_type = static_cast<WireType>(tag & 0x7);
+        const TableField* field = FindField(table, tag >> 3, hint);
+        if (field == nullptr) {
+            // TODO: Keep unknown fields so that they survive re-encoding.
+            if (!SkipUnknownField(cis, wire_type)) {
+                return false;
+            }
+            continue;
+        }
+        if (wire_type == kLen && field->repeated && field->wire_type != kLen) {
+            // Repeated scalar fields may be packed whether or not they are
+            // declared so.
+            if (!ParsePacked(cis, *field, message)) {
+                return false;
+            }
+            continue;
+        }
+        if (field->wire_type != wire_type) {
+            cerr << "The wire type doesn't match the field type. tag: "
+                 << field->number << ", wire type: " << wire_type << endl;
+            return false;
+        }
+
+        bool result = false;
+        switch (wire_type) {
+            case kVarint:
+                result = ParseVarint(cis, *field, message);
+                break;
+            case kI64:
+                result = ParseFixedInt64(cis, *field, message);
+                break;
+            case kI32:
+                result = ParseFixedInt32(cis, *field, message);
+                break;
+            case kLen:
+                result = ParseLenPrefix(cis, *field, message);
+                break;
+            case kDeprecated_SGroup:
+            case kDeprecated_EGroup:
+                break;
+        }
+        if (!result) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace decaproto
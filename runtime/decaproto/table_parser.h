@@ -0,0 +1,64 @@
+#ifndef DECAPROTO_TABLE_PARSER_H
+#define DECAPROTO_TABLE_PARSER_H
+
+#include <cstdint>
+
+#include "decaproto/descriptor.h"
+#include "decaproto/stream/coded_stream.h"
+
+namespace decaproto {
+
+// Table-driven decoding of generated messages.
+//
+// The code generator emits a constant ParseTable per message which tells
+// where each field lives in the message object, and ParseWithTable() decodes
+// any message from its table. Unlike the generated DecodeImpl, there is only
+// one copy of the decoding code however many messages there are, which
+// matters for firmware images. Unlike the reflection-based decoder, fields
+// are stored without std::function calls or std::map lookups.
+//
+// Pass `decoder=table` to the code generator to make DecodeImpl of the
+// generated messages use their tables.
+
+struct ParseTable;
+
+// Describes how to store a field.
+struct TableField {
+    uint32_t number;
+    WireType wire_type;
+    FieldType type;
+    bool repeated;
+
+    // Offset of the holder of the field in the message. It's T for
+    // singular scalar fields, std::string for singular string fields, and
+    // std::vector<T> for repeated fields of type T except enums and messages.
+    uint32_t offset;
+
+    // Offset of the std::string_view which aliases the input buffer for
+    // singular string fields (see CodedInputStream::EnableAliasing).
+    uint32_t view_offset;
+
+    // Returns the object to decode into, i.e. mutable_xxx() for singular
+    // message fields and add_xxx() for repeated message and enum fields,
+    // whose holders can't be handled without knowing their types.
+    void* (*mutable_field)(void* message);
+
+    // Table of the message type of message fields.
+    const ParseTable* sub_table;
+};
+
+struct ParseTable {
+    // Sorted by field number
+    const TableField* fields;
+    uint32_t num_fields;
+};
+
+// Decodes fields from `cis` into `message` until the current limit of `cis`,
+// or until its end if no limit is pushed. `message` must point to the
+// generated message `table` belongs to.
+bool ParseWithTable(
+        CodedInputStream& cis, const ParseTable& table, void* message);
+
+}  // namespace decaproto
+
+#endif  // DECAPROTO_TABLE_PARSER_H
@@ -0,0 +1,166 @@
+#include "decaproto/stream/array_stream.h"
+
+#include <gtest/gtest.h>
+
+#include "decaproto/stream/coded_stream.h"
+
+using namespace decaproto;
+using namespace std;
+
+TEST(ArrayStreamTest, ReadTest) {
+    const uint8_t data[] = {0x01, 0x02, 0x03};
+    ArrayInputStream ins(data, sizeof(data));
+
+    uint8_t b;
+    EXPECT_TRUE(ins.Read(b));
+    EXPECT_EQ(0x01, b);
+
+    uint8_t buf[2];
+    EXPECT_TRUE(ins.ReadBytes(buf, 2));
+    EXPECT_EQ(0x02, buf[0]);
+    EXPECT_EQ(0x03, buf[1]);
+    EXPECT_EQ(3, ins.Position());
+
+    EXPECT_FALSE(ins.Read(b));
+    EXPECT_FALSE(ins.ReadBytes(buf, 1));
+}
+
+TEST(ArrayStreamTest, WriteTest) {
+    uint8_t data[3];
+    ArrayOutputStream outs(data, sizeof(data));
+
+    EXPECT_TRUE(outs.Write(0x01));
+    const uint8_t src[] = {0x02, 0x03};
+    EXPECT_TRUE(outs.WriteBytes(src, 2));
+    EXPECT_EQ(3, outs.WrittenSize());
+    EXPECT_EQ(0x01, data[0]);
+    EXPECT_EQ(0x02, data[1]);
+    EXPECT_EQ(0x03, data[2]);
+
+    // The buffer is full
+    EXPECT_FALSE(outs.Write(0x04));
+    EXPECT_FALSE(outs.WriteBytes(src, 1));
+}
+
+TEST(ArrayStreamTest, CodedInputStreamTest) {
+    // 150, "test", fixed32 0x67452301
+    string data("\x96\x01test\x01\x23\x45\x67", 10);
+    ArrayInputStream ins(data);
+
+    {
+        CodedInputStream cis(&ins);
+        uint64_t value;
+        EXPECT_TRUE(cis.ReadVarint64(value));
+        EXPECT_EQ(150, value);
+        EXPECT_EQ(2, cis.ConsumedSize());
+
+        string str;
+        EXPECT_TRUE(cis.ReadString(str, 4));
+        EXPECT_EQ("test", str);
+        EXPECT_EQ(6, cis.ConsumedSize());
+    }
+    // CodedInputStream gives the consumed size back to the stream when it's
+    // destroyed. So that we can continue reading the stream.
+    EXPECT_EQ(6, ins.Position());
+
+    CodedInputStream cis(&ins);
+    uint32_t fixed;
+    EXPECT_TRUE(cis.ReadFixedInt32(fixed));
+    EXPECT_EQ(0x67452301, fixed);
+    EXPECT_EQ(4, cis.ConsumedSize());
+
+    // End of the buffer
+    uint64_t value;
+    EXPECT_FALSE(cis.ReadVarint64(value));
+}
+
+TEST(ArrayStreamTest, CodedInputStreamRawBufferTest) {
+    const uint8_t data[] = {0x96, 0x01, 0x0A};
+    CodedInputStream cis(data, sizeof(data));
+
+    uint32_t value;
+    EXPECT_TRUE(cis.ReadVarint32(value));
+    EXPECT_EQ(150, value);
+
+    cis.Skip(1);
+    EXPECT_EQ(3, cis.ConsumedSize());
+    EXPECT_FALSE(cis.ReadVarint32(value));
+}
+
+TEST(ArrayStreamTest, CodedInputStreamTruncatedTest) {
+    // varint which doesn't terminate
+    const uint8_t varint[] = {0x96, 0x96};
+    CodedInputStream varint_cis(varint, sizeof(varint));
+    uint64_t value;
+    EXPECT_FALSE(varint_cis.ReadVarint64(value));
+
+    // string which is shorter than its length
+    const uint8_t str[] = {'t', 'e', 's'};
+    CodedInputStream str_cis(str, sizeof(str));
+    string result;
+    EXPECT_FALSE(str_cis.ReadString(result, 4));
+
+    // fixed64 which is shorter than 8 bytes
+    const uint8_t fixed[] = {0x01, 0x02, 0x03, 0x04};
+    CodedInputStream fixed_cis(fixed, sizeof(fixed));
+    uint64_t fixed_value;
+    EXPECT_FALSE(fixed_cis.ReadFixedInt64(fixed_value));
+}
+
+TEST(ArrayStreamTest, CodedOutputStreamTest) {
+    uint8_t data[16];
+    ArrayOutputStream outs(data, sizeof(data));
+
+    {
+        CodedOutputStream cos(&outs);
+        EXPECT_TRUE(cos.WriteVarint64(150));
+        EXPECT_TRUE(cos.WriteString("test"));
+        EXPECT_TRUE(cos.WriteFixedInt32(0x67452301));
+        EXPECT_EQ(10, cos.WrittenSize());
+    }
+    EXPECT_EQ(10, outs.WrittenSize());
+    EXPECT_EQ(
+            string("\x96\x01test\x01\x23\x45\x67", 10),
+            string(reinterpret_cast<char*>(data), 10));
+}
+
+TEST(ArrayStreamTest, CodedOutputStreamOverflowTest) {
+    uint8_t data[3];
+    CodedOutputStream cos(data, sizeof(data));
+
+    EXPECT_TRUE(cos.WriteVarint64(150));
+    EXPECT_FALSE(cos.WriteString("test"));
+    EXPECT_FALSE(cos.WriteFixedInt32(0));
+    EXPECT_TRUE(cos.WriteVarint64(1));
+    EXPECT_FALSE(cos.WriteVarint64(1));
+    EXPECT_EQ(3, cos.WrittenSize());
+}
+
+TEST(ArrayStreamTest, CodedOutputStreamHadErrorTest) {
+    uint8_t data[4];
+    CodedOutputStream cos(data, sizeof(data));
+
+    EXPECT_TRUE(cos.WriteVarint64(150));
+    EXPECT_FALSE(cos.HadError());
+    EXPECT_FALSE(cos.WriteString("test"));
+    EXPECT_TRUE(cos.HadError());
+    // Later successful writes don't clear the error.
+    EXPECT_TRUE(cos.WriteVarint64(1));
+    EXPECT_TRUE(cos.HadError());
+}
+
+TEST(ArrayStreamTest, SkipTest) {
+    const uint8_t data[] = {1, 2, 3, 4, 5};
+    ArrayInputStream ins(data, sizeof(data));
+
+    EXPECT_TRUE(ins.Skip(2));
+    uint8_t b;
+    EXPECT_TRUE(ins.Read(b));
+    EXPECT_EQ(3, b);
+    EXPECT_TRUE(ins.Skip(0));
+
+    // Skipping past the end fails and leaves the stream at the end.
+    EXPECT_FALSE(ins.Skip(3));
+    EXPECT_EQ(sizeof(data), ins.Position());
+    EXPECT_FALSE(ins.Read(b));
+}
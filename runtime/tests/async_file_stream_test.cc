@@ -0,0 +1,176 @@
+#include "decaproto/stream/async_file_stream.h"
+
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include "decaproto/delimited.h"
+#include "decaproto/stream/array_stream.h"
+#include "decaproto/stream/coded_stream.h"
+#include "decaproto/stream/string_stream.h"
+#include "fake_message.h"
+
+using namespace decaproto;
+using namespace std;
+
+namespace {
+
+class TempFile {
+public:
+    string path;
+    int fd;
+
+    TempFile() {
+        path = testing::TempDir() + "async_file_stream_test.XXXXXX";
+        fd = mkstemp(&path[0]);
+        EXPECT_GE(fd, 0);
+    }
+
+    ~TempFile() {
+        close(fd);
+        unlink(path.c_str());
+    }
+
+    string Read() {
+        ifstream ifs(path, ios::binary);
+        stringstream ss;
+        ss << ifs.rdbuf();
+        return ss.str();
+    }
+};
+
+void WriteAndVerify(AsyncFileOutputStream::Backend backend) {
+    TempFile file;
+    const int kCount = 1000;
+    {
+        // Small buffers so that many of them are in flight
+        AsyncFileOutputStream stream(file.fd, 64, 4, backend);
+        for (int i = 0; i < kCount; i++) {
+            FakeMessage msg;
+            msg.set_num(i);
+            msg.set_str("message " + to_string(i));
+            CodedOutputStream cos(&stream);
+            EXPECT_TRUE(EncodeDelimited(msg, cos));
+        }
+        EXPECT_TRUE(stream.Flush());
+        EXPECT_FALSE(stream.HadError());
+    }
+
+    string content = file.Read();
+    DelimitedReader reader(
+            reinterpret_cast<const uint8_t*>(content.data()), content.size());
+    FakeMessage msg;
+    int count = 0;
+    while (reader.Next(&msg)) {
+        EXPECT_EQ(count, msg.num());
+        EXPECT_EQ("message " + to_string(count), msg.str());
+        count++;
+    }
+    EXPECT_FALSE(reader.HadError());
+    EXPECT_EQ(kCount, count);
+}
+
+}  // namespace
+
+TEST(AsyncFileStreamTest, ThreadPoolTest) {
+    WriteAndVerify(AsyncFileOutputStream::kThreadPool);
+}
+
+TEST(AsyncFileStreamTest, AutoTest) {
+    // Uses io_uring if the kernel allows it
+    WriteAndVerify(AsyncFileOutputStream::kAuto);
+}
+
+TEST(AsyncFileStreamTest, ByteCountTest) {
+    TempFile file;
+    AsyncFileOutputStream stream(file.fd, 16, 2);
+    {
+        CodedOutputStream cos(&stream);
+        EXPECT_TRUE(cos.WriteString(string(40, 'x')));
+        EXPECT_EQ(40, cos.WrittenSize());
+    }
+    EXPECT_EQ(40, stream.ByteCount());
+    EXPECT_TRUE(stream.Flush());
+    EXPECT_EQ(string(40, 'x'), file.Read());
+}
+
+TEST(AsyncFileStreamTest, WriteErrorTest) {
+    // Not writable
+    int fd = open("/dev/null", O_RDONLY);
+    AsyncFileOutputStream stream(fd, 16, 2);
+    {
+        CodedOutputStream cos(&stream);
+        EXPECT_TRUE(cos.WriteString("test"));
+    }
+    EXPECT_FALSE(stream.Flush());
+    EXPECT_TRUE(stream.HadError());
+    close(fd);
+}
+
+TEST(AsyncFileStreamTest, WriteErrorInFlightTest) {
+    TempFile file;
+    AsyncFileOutputStream stream(
+            file.fd, 16, 8, AsyncFileOutputStream::kThreadPool);
+
+    // Writes beyond 40 bytes fail with EFBIG instead of raising SIGXFSZ.
+    struct rlimit old_limit;
+    ASSERT_EQ(0, getrlimit(RLIMIT_FSIZE, &old_limit));
+    struct rlimit limit = old_limit;
+    limit.rlim_cur = 40;
+    void (*old_handler)(int) = signal(SIGXFSZ, SIG_IGN);
+    ASSERT_EQ(0, setrlimit(RLIMIT_FSIZE, &limit));
+
+    // The buffers are submitted without waiting, so the later ones are still
+    // in flight when the third one fails.
+    bool next_ok = true;
+    for (int i = 0; i < 8; i++) {
+        void* data;
+        int size;
+        if (!stream.Next(&data, &size)) {
+            next_ok = false;
+            break;
+        }
+        memset(data, 'a' + i, size);
+    }
+    bool flushed = stream.Flush();
+
+    setrlimit(RLIMIT_FSIZE, &old_limit);
+    signal(SIGXFSZ, old_handler);
+
+    EXPECT_TRUE(next_ok);
+    EXPECT_FALSE(flushed);
+    EXPECT_TRUE(stream.HadError());
+    // Flush() waits for the writes after the failed one.
+    EXPECT_EQ(0, stream.InFlightCount());
+    EXPECT_EQ(string(16, 'a') + string(16, 'b'), file.Read().substr(0, 32));
+}
+
+TEST(AsyncFileStreamTest, BatchWritesTest) {
+    TempFile file;
+    const int kCount = 1000;
+    string expected;
+    {
+        AsyncFileOutputStream stream(file.fd, 4096, 4);
+        for (int i = 0; i < kCount; i++) {
+            FakeMessage msg;
+            msg.set_num(i);
+            msg.set_str("message " + to_string(i));
+            size_t size;
+            EXPECT_TRUE(msg.Encode(stream, size));
+
+            StringOutputStream out(&expected);
+            EXPECT_TRUE(msg.Encode(out, size));
+        }
+        EXPECT_TRUE(stream.Flush());
+        // Messages share buffers instead of being written one by one.
+        EXPECT_LE(stream.SubmitCount(), expected.size() / 4096 + 1);
+        EXPECT_LT(stream.SubmitCount(), kCount / 10);
+    }
+    EXPECT_EQ(expected, file.Read());
+}
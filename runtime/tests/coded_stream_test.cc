@@ -5,6 +5,7 @@
 #include <sstream>
 
 #include "decaproto/stream/stl.h"
+#include "decaproto/stream/string_stream.h"
 
 using namespace decaproto;
 using namespace std;
@@ -16,7 +17,8 @@ TEST(StreamTest, ReadOneTest) {
     // 1 is encoded as 0000 0001
     ss.put(0x01);
 
-    CodedInputStream cis(new StlInputStream(&ss));
+    StlInputStream in(&ss);
+    CodedInputStream cis(&in);
     uint64_t result;
     EXPECT_TRUE(cis.ReadVarint64(result));
     EXPECT_EQ(1, result);
@@ -28,7 +30,8 @@ TEST(StreamTest, ReadTest) {
     ss.put(0x96);
     ss.put(0x01);
 
-    CodedInputStream cis(new StlInputStream(&ss));
+    StlInputStream in(&ss);
+    CodedInputStream cis(&in);
     uint64_t result;
     EXPECT_TRUE(cis.ReadVarint64(result));
     EXPECT_EQ(150, result);
@@ -40,7 +43,8 @@ TEST(StreamTest, ReadUint32Test) {
     ss.put(0x96);
     ss.put(0x01);
 
-    CodedInputStream cis(new StlInputStream(&ss));
+    StlInputStream in(&ss);
+    CodedInputStream cis(&in);
     uint32_t result;
     EXPECT_TRUE(cis.ReadVarint32(result));
     EXPECT_EQ(150, result);
@@ -58,7 +62,8 @@ TEST(StreamTest, SignedTest) {
     ss.put(0x02);
     ss.put(0x03);
 
-    CodedInputStream cis(new StlInputStream(&ss));
+    StlInputStream in(&ss);
+    CodedInputStream cis(&in);
     int64_t result;
     EXPECT_TRUE(cis.ReadSignedVarint64(result));
     EXPECT_EQ(0, result);
@@ -85,7 +90,8 @@ TEST(StreamTest, SignedInt32Test) {
     ss.put(0x02);
     ss.put(0x03);
 
-    CodedInputStream cis(new StlInputStream(&ss));
+    StlInputStream in(&ss);
+    CodedInputStream cis(&in);
     int32_t result;
     EXPECT_TRUE(cis.ReadSignedVarint32(result));
     EXPECT_EQ(0, result);
@@ -128,7 +134,8 @@ TEST(StreamTest, BiggerSignedTest) {
     ss.put(0xFF);
     ss.put(0x01);
 
-    CodedInputStream cis(new StlInputStream(&ss));
+    StlInputStream in(&ss);
+    CodedInputStream cis(&in);
 
     // Parse first value as unsigned value
     uint64_t unsigned_value;
@@ -152,7 +159,8 @@ TEST(StreamTest, ReadBigValueTest) {
     ss.put(0x80);
     ss.put(0x10);
 
-    CodedInputStream cis(new StlInputStream(&ss));
+    StlInputStream in(&ss);
+    CodedInputStream cis(&in);
     uint64_t result;
     EXPECT_TRUE(cis.ReadVarint64(result));
     EXPECT_EQ(uint64_t{1} << 32, result);
@@ -169,7 +177,8 @@ TEST(StreamTest, ReadOverflow32bitsTest) {
     ss.put(0x80);
     ss.put(0x10);
 
-    CodedInputStream cis(new StlInputStream(&ss));
+    StlInputStream in(&ss);
+    CodedInputStream cis(&in);
     uint32_t result;
     EXPECT_FALSE(cis.ReadVarint32(result));
 }
@@ -189,7 +198,8 @@ TEST(StreamTest, ReadMultipleVarintsTest) {
     ss.put(0x80 | (0x02 << 1));
     ss.put(0x00 | (0x03 << 2));
 
-    CodedInputStream cis(new StlInputStream(&ss));
+    StlInputStream in(&ss);
+    CodedInputStream cis(&in);
     uint64_t result;
 
     // Test reading first varint
@@ -220,7 +230,8 @@ TEST(StreamTest, ReadVarintWithMaxValueTest) {
     ss.put(0xFF);  // 7bits * 9 = 63 bits
     ss.put(0x01);  // last one bit + MSO bit off to signal end of varint
 
-    CodedInputStream cis(new StlInputStream(&ss));
+    StlInputStream in(&ss);
+    CodedInputStream cis(&in);
     uint64_t result;
 
     EXPECT_TRUE(cis.ReadVarint64(result));
@@ -232,7 +243,8 @@ TEST(StreamTest, ReadVarintWithZeroTest) {
     // Writing a zero varint
     ss.put(0x00);  // Single byte for zero
 
-    CodedInputStream cis(new StlInputStream(&ss));
+    StlInputStream in(&ss);
+    CodedInputStream cis(&in);
     uint64_t result;
 
     EXPECT_TRUE(cis.ReadVarint64(result));
@@ -244,7 +256,8 @@ TEST(StreamTest, ReadVarintFailureTest) {
     // Simulate a failure in reading varint by not putting any data in the
     // stream
 
-    CodedInputStream cis(new StlInputStream(&ss));
+    StlInputStream in(&ss);
+    CodedInputStream cis(&in);
     uint64_t result;
     EXPECT_FALSE(cis.ReadVarint64(result));
 
@@ -267,7 +280,8 @@ TEST(StreamTest, ReadVarintOverflowFailureTest) {
     ss.put(0xFF);
     ss.put(0x01);  // 7bits * 10 + 1 = 71 bits
 
-    CodedInputStream cis(new StlInputStream(&ss));
+    StlInputStream in(&ss);
+    CodedInputStream cis(&in);
     uint64_t result;
     EXPECT_FALSE(cis.ReadVarint64(result));
 }
@@ -284,7 +298,8 @@ TEST(StreamTest, ReadFixedInt64Test) {
     ss.put(0xCD);
     ss.put(0xEF);
 
-    CodedInputStream cis(new StlInputStream(&ss));
+    StlInputStream in(&ss);
+    CodedInputStream cis(&in);
     uint64_t result;
     EXPECT_TRUE(cis.ReadFixedInt64(result));
     EXPECT_EQ(0xEFCDAB8967452301, result);
@@ -298,7 +313,8 @@ TEST(StreamTest, ReadFixedInt32Test) {
     ss.put(0x45);
     ss.put(0x67);
 
-    CodedInputStream cis(new StlInputStream(&ss));
+    StlInputStream in(&ss);
+    CodedInputStream cis(&in);
     uint32_t result;
     EXPECT_TRUE(cis.ReadFixedInt32(result));
     EXPECT_EQ(0x67452301, result);
@@ -306,8 +322,10 @@ TEST(StreamTest, ReadFixedInt32Test) {
 
 TEST(StreamTest, WriteOneVarint64Test) {
     stringstream ss;
-    CodedOutputStream cos(new StlOutputStream(&ss));
-    CodedInputStream cis(new StlInputStream(&ss));
+    StlOutputStream out(&ss);
+    CodedOutputStream cos(&out);
+    StlInputStream in(&ss);
+    CodedInputStream cis(&in);
 
     EXPECT_TRUE(cos.WriteVarint64(1));
 
@@ -318,8 +336,10 @@ TEST(StreamTest, WriteOneVarint64Test) {
 
 TEST(StreamTest, WriteMultipleVarint64Test) {
     stringstream ss;
-    CodedOutputStream cos(new StlOutputStream(&ss));
-    CodedInputStream cis(new StlInputStream(&ss));
+    StlOutputStream out(&ss);
+    CodedOutputStream cos(&out);
+    StlInputStream in(&ss);
+    CodedInputStream cis(&in);
 
     uint64_t values[] = {0, 1, 150, 100, 654321, 123456, UINT64_MAX};
     for (auto value : values) {
@@ -335,8 +355,10 @@ TEST(StreamTest, WriteMultipleVarint64Test) {
 
 TEST(StreamTest, WriteMultipleVarint64_Minus_Test) {
     stringstream ss;
-    CodedOutputStream cos(new StlOutputStream(&ss));
-    CodedInputStream cis(new StlInputStream(&ss));
+    StlOutputStream out(&ss);
+    CodedOutputStream cos(&out);
+    StlInputStream in(&ss);
+    CodedInputStream cis(&in);
 
     int64_t values[] = {0, 1, 150, -100, 654321, -123456, INT64_MIN, INT64_MAX};
     for (auto value : values) {
@@ -352,8 +374,10 @@ TEST(StreamTest, WriteMultipleVarint64_Minus_Test) {
 
 TEST(StreamTest, WriteOneVarint32Test) {
     stringstream ss;
-    CodedOutputStream cos(new StlOutputStream(&ss));
-    CodedInputStream cis(new StlInputStream(&ss));
+    StlOutputStream out(&ss);
+    CodedOutputStream cos(&out);
+    StlInputStream in(&ss);
+    CodedInputStream cis(&in);
 
     EXPECT_TRUE(cos.WriteVarint64(10));
 
@@ -364,8 +388,10 @@ TEST(StreamTest, WriteOneVarint32Test) {
 
 TEST(StreamTest, WriteMultipleVarint32Test) {
     stringstream ss;
-    CodedOutputStream cos(new StlOutputStream(&ss));
-    CodedInputStream cis(new StlInputStream(&ss));
+    StlOutputStream out(&ss);
+    CodedOutputStream cos(&out);
+    StlInputStream in(&ss);
+    CodedInputStream cis(&in);
 
     uint64_t values[] = {0, 1, 150, 123456, 1000, 654321, UINT32_MAX};
     for (auto value : values) {
@@ -381,8 +407,10 @@ TEST(StreamTest, WriteMultipleVarint32Test) {
 
 TEST(StreamTest, WriteOneSignedVarint32Test) {
     stringstream ss;
-    CodedOutputStream cos(new StlOutputStream(&ss));
-    CodedInputStream cis(new StlInputStream(&ss));
+    StlOutputStream out(&ss);
+    CodedOutputStream cos(&out);
+    StlInputStream in(&ss);
+    CodedInputStream cis(&in);
 
     EXPECT_TRUE(cos.WriteSignedVarint32(-123456));
 
@@ -393,8 +421,10 @@ TEST(StreamTest, WriteOneSignedVarint32Test) {
 
 TEST(StreamTest, WriteMultipleSignedVarint32Test) {
     stringstream ss;
-    CodedOutputStream cos(new StlOutputStream(&ss));
-    CodedInputStream cis(new StlInputStream(&ss));
+    StlOutputStream out(&ss);
+    CodedOutputStream cos(&out);
+    StlInputStream in(&ss);
+    CodedInputStream cis(&in);
 
     int32_t values[] = {
             0, 1, 150, -200, 123456, 1000, 654321, INT32_MIN, INT32_MAX};
@@ -411,8 +441,10 @@ TEST(StreamTest, WriteMultipleSignedVarint32Test) {
 
 TEST(StreamTest, WriteOneSignedVarint64Test) {
     stringstream ss;
-    CodedOutputStream cos(new StlOutputStream(&ss));
-    CodedInputStream cis(new StlInputStream(&ss));
+    StlOutputStream out(&ss);
+    CodedOutputStream cos(&out);
+    StlInputStream in(&ss);
+    CodedInputStream cis(&in);
 
     EXPECT_TRUE(cos.WriteSignedVarint64(-123456));
 
@@ -423,8 +455,10 @@ TEST(StreamTest, WriteOneSignedVarint64Test) {
 
 TEST(StreamTest, WriteMultipleSignedVarint64Test) {
     stringstream ss;
-    CodedOutputStream cos(new StlOutputStream(&ss));
-    CodedInputStream cis(new StlInputStream(&ss));
+    StlOutputStream out(&ss);
+    CodedOutputStream cos(&out);
+    StlInputStream in(&ss);
+    CodedInputStream cis(&in);
 
     int64_t values[] = {
             0,
@@ -448,3 +482,443 @@ TEST(StreamTest, WriteMultipleSignedVarint64Test) {
         EXPECT_EQ(value, result);
     }
 }
+
+namespace {
+
+// An InputStream which provides only the per-byte Read() so that we can test
+// the default ReadBytes() implementation.
+class ByteInputStream : public InputStream {
+    const string data_;
+    size_t pos_;
+
+public:
+    ByteInputStream(const string& data) : data_(data), pos_(0) {
+    }
+
+    bool Read(uint8_t& out) override {
+        if (pos_ >= data_.size()) {
+            return false;
+        }
+        out = data_[pos_++];
+        return true;
+    }
+};
+
+}  // namespace
+
+TEST(StreamTest, DefaultReadBytesTest) {
+    ByteInputStream ins("abc");
+
+    uint8_t buf[3];
+    EXPECT_TRUE(ins.ReadBytes(buf, 2));
+    EXPECT_EQ('a', buf[0]);
+    EXPECT_EQ('b', buf[1]);
+
+    // Only 1 byte is left
+    EXPECT_FALSE(ins.ReadBytes(buf, 2));
+}
+
+TEST(StreamTest, ReadStringTest) {
+    stringstream ss;
+    ss << "testing";
+
+    StlInputStream in(&ss);
+    CodedInputStream cis(&in);
+    string result;
+    EXPECT_TRUE(cis.ReadString(result, 4));
+    EXPECT_EQ("test", result);
+    EXPECT_EQ(4, cis.ConsumedSize());
+
+    EXPECT_TRUE(cis.ReadString(result, 3));
+    EXPECT_EQ("ing", result);
+    EXPECT_EQ(7, cis.ConsumedSize());
+}
+
+TEST(StreamTest, ReadStringWithDefaultReadBytesTest) {
+    ByteInputStream in("testing");
+    CodedInputStream cis(&in);
+    string result;
+    EXPECT_TRUE(cis.ReadString(result, 7));
+    EXPECT_EQ("testing", result);
+}
+
+TEST(StreamTest, ReadLongStringTest) {
+    // Longer than the chunk size ReadString grows the string by
+    string src(10000, 'x');
+    src[0] = 'a';
+    src[9999] = 'z';
+    stringstream ss;
+    ss << src;
+
+    StlInputStream in(&ss);
+    CodedInputStream cis(&in);
+    string result;
+    EXPECT_TRUE(cis.ReadString(result, src.size()));
+    EXPECT_EQ(src, result);
+}
+
+TEST(StreamTest, ReadStringFailureTest) {
+    stringstream ss;
+    ss << "test";
+
+    StlInputStream in(&ss);
+    CodedInputStream cis(&in);
+    string result;
+    EXPECT_FALSE(cis.ReadString(result, 5));
+}
+
+TEST(StreamTest, WriteStringTest) {
+    stringstream ss;
+    StlOutputStream out(&ss);
+    CodedOutputStream cos(&out);
+
+    EXPECT_TRUE(cos.WriteString("testing"));
+    EXPECT_EQ(7, cos.WrittenSize());
+    EXPECT_EQ("testing", ss.str());
+}
+
+TEST(StreamTest, WriteFixedInt32Test) {
+    stringstream ss;
+    StlOutputStream out(&ss);
+    CodedOutputStream cos(&out);
+    StlInputStream in(&ss);
+    CodedInputStream cis(&in);
+
+    EXPECT_TRUE(cos.WriteFixedInt32(0x67452301));
+    EXPECT_EQ(4, cos.WrittenSize());
+    EXPECT_EQ(string("\x01\x23\x45\x67"), ss.str());
+
+    uint32_t result;
+    EXPECT_TRUE(cis.ReadFixedInt32(result));
+    EXPECT_EQ(0x67452301, result);
+}
+
+TEST(StreamTest, WriteFixedInt64Test) {
+    stringstream ss;
+    StlOutputStream out(&ss);
+    CodedOutputStream cos(&out);
+    StlInputStream in(&ss);
+    CodedInputStream cis(&in);
+
+    EXPECT_TRUE(cos.WriteFixedInt64(0xEFCDAB8967452301));
+    EXPECT_EQ(8, cos.WrittenSize());
+
+    uint64_t result;
+    EXPECT_TRUE(cis.ReadFixedInt64(result));
+    EXPECT_EQ(0xEFCDAB8967452301, result);
+}
+
+TEST(StreamTest, ReadFixedInt64FailureTest) {
+    stringstream ss;
+    // Only 7 bytes
+    ss << "1234567";
+
+    StlInputStream in(&ss);
+    CodedInputStream cis(&in);
+    uint64_t result;
+    EXPECT_FALSE(cis.ReadFixedInt64(result));
+}
+
+TEST(StreamTest, ReadVarintFastPathTest) {
+    // Every length of varint followed by enough bytes to take the unrolled
+    // path, and the same varint at the very end of the buffer to take the
+    // byte-by-byte path.
+    for (int bits = 0; bits <= 64; bits++) {
+        uint64_t value = bits == 64 ? UINT64_MAX : (1ULL << bits) - 1;
+        string encoded;
+        {
+            StringOutputStream outs(&encoded);
+            CodedOutputStream cos(&outs);
+            EXPECT_TRUE(cos.WriteVarint64(value));
+        }
+        size_t varint_size = encoded.size();
+        encoded += string(10, '\0');
+
+        CodedInputStream fast(
+                reinterpret_cast<const uint8_t*>(encoded.data()),
+                encoded.size());
+        uint64_t result;
+        EXPECT_TRUE(fast.ReadVarint64(result));
+        EXPECT_EQ(value, result);
+        EXPECT_EQ(varint_size, fast.ConsumedSize());
+
+        CodedInputStream slow(
+                reinterpret_cast<const uint8_t*>(encoded.data()), varint_size);
+        EXPECT_TRUE(slow.ReadVarint64(result));
+        EXPECT_EQ(value, result);
+        EXPECT_EQ(varint_size, slow.ConsumedSize());
+    }
+}
+
+TEST(StreamTest, ReadVarintFastPathOverflowTest) {
+    // 11 bytes varint
+    string encoded(10, '\xff');
+    encoded += string(5, '\x01');
+    CodedInputStream cis(
+            reinterpret_cast<const uint8_t*>(encoded.data()), encoded.size());
+    uint64_t result;
+    EXPECT_FALSE(cis.ReadVarint64(result));
+}
+
+TEST(StreamTest, VarintSizeTest) {
+    EXPECT_EQ(1, CodedOutputStream::VarintSize64(0));
+    for (int bits = 1; bits <= 64; bits++) {
+        uint64_t value = bits == 64 ? UINT64_MAX : (1ULL << bits) - 1;
+        EXPECT_EQ((bits + 6) / 7, CodedOutputStream::VarintSize64(value))
+                << "bits: " << bits;
+    }
+}
+
+TEST(StreamTest, WriteVarintFastPathTest) {
+    // Compare the single-store path (flat buffer with enough room) against
+    // the byte-by-byte encoding for every length of varint.
+    for (int bits = 0; bits <= 64; bits++) {
+        uint64_t value = bits == 64 ? UINT64_MAX : (1ULL << bits) - 1;
+        uint8_t expected[10];
+        size_t expected_size = 0;
+        uint64_t v = value;
+        do {
+            expected[expected_size] = v & 0x7f;
+            v >>= 7;
+            if (v > 0) {
+                expected[expected_size] |= 0x80;
+            }
+            expected_size++;
+        } while (v > 0);
+
+        uint8_t buf[20] = {};
+        CodedOutputStream cos(buf, sizeof(buf));
+        EXPECT_TRUE(cos.WriteVarint64(value));
+        ASSERT_EQ(expected_size, cos.WrittenSize()) << "bits: " << bits;
+        EXPECT_EQ(0, memcmp(expected, buf, expected_size)) << "bits: " << bits;
+
+        // Just enough room for the varint
+        uint8_t exact[10] = {};
+        CodedOutputStream exact_cos(exact, expected_size);
+        EXPECT_TRUE(exact_cos.WriteVarint64(value));
+        EXPECT_EQ(0, memcmp(expected, exact, expected_size));
+    }
+}
+
+TEST(StreamTest, WriteVarintNoRoomTest) {
+    uint8_t buf[1];
+    CodedOutputStream cos(buf, sizeof(buf));
+    // 150 needs 2 bytes
+    EXPECT_FALSE(cos.WriteVarint64(150));
+    EXPECT_EQ(0, cos.WrittenSize());
+}
+
+TEST(StreamTest, FixedArrayTest) {
+    vector<double> doubles = {0.0, -1.5, 3.25, 1e300, -0.0};
+    vector<uint32_t> uints = {0, 1, 0x04030201, UINT32_MAX};
+
+    string encoded;
+    {
+        StringOutputStream outs(&encoded);
+        CodedOutputStream cos(&outs);
+        EXPECT_TRUE(cos.WriteFixedArray(doubles));
+        EXPECT_TRUE(cos.WriteFixedArray(uints));
+    }
+    ASSERT_EQ(doubles.size() * 8 + uints.size() * 4, encoded.size());
+    // Little-endian on the wire
+    size_t uints_offset = doubles.size() * 8;
+    EXPECT_EQ('\x01', encoded[uints_offset + 8]);
+    EXPECT_EQ('\x04', encoded[uints_offset + 11]);
+
+    {
+        // In place
+        CodedInputStream cis(
+                reinterpret_cast<const uint8_t*>(encoded.data()),
+                encoded.size());
+        vector<double> result_doubles = {42.0};
+        vector<uint32_t> result_uints;
+        EXPECT_TRUE(cis.ReadFixedArray(result_doubles, doubles.size() * 8));
+        EXPECT_TRUE(cis.ReadFixedArray(result_uints, uints.size() * 4));
+        doubles.insert(doubles.begin(), 42.0);
+        EXPECT_EQ(doubles, result_doubles);
+        EXPECT_EQ(uints, result_uints);
+        doubles.erase(doubles.begin());
+    }
+    {
+        // Values span chunks
+        StringZeroCopyInputStream ins(&encoded, 3);
+        CodedInputStream cis(&ins);
+        vector<double> result_doubles;
+        vector<uint32_t> result_uints;
+        EXPECT_TRUE(cis.ReadFixedArray(result_doubles, doubles.size() * 8));
+        EXPECT_TRUE(cis.ReadFixedArray(result_uints, uints.size() * 4));
+        EXPECT_EQ(doubles, result_doubles);
+        EXPECT_EQ(uints, result_uints);
+    }
+}
+
+TEST(StreamTest, FixedArrayFailureTest) {
+    string encoded(12, '\0');
+    vector<uint64_t> result;
+    {
+        // Not a multiple of 8
+        CodedInputStream cis(
+                reinterpret_cast<const uint8_t*>(encoded.data()),
+                encoded.size());
+        EXPECT_FALSE(cis.ReadFixedArray(result, 12));
+    }
+    {
+        // Longer than the data
+        stringstream ss(encoded);
+        StlInputStream in(&ss);
+        CodedInputStream cis(&in);
+        EXPECT_FALSE(cis.ReadFixedArray(result, 16));
+        EXPECT_TRUE(result.empty());
+    }
+    {
+        // Fails after some chunks are read
+        string longer(8192, '\0');
+        stringstream ss(longer);
+        StlInputStream in(&ss);
+        CodedInputStream cis(&in);
+        result.assign(1, 42);
+        EXPECT_FALSE(cis.ReadFixedArray(result, 8200));
+        EXPECT_EQ(vector<uint64_t>{42}, result);
+    }
+}
+
+namespace {
+
+void CheckLimits(CodedInputStream& cis) {
+    EXPECT_EQ(SIZE_MAX, cis.BytesUntilLimit());
+    EXPECT_FALSE(cis.ReachedLimit());
+
+    uint32_t value;
+    EXPECT_TRUE(cis.ReadVarint32(value));
+    EXPECT_EQ(1, value);
+
+    EXPECT_TRUE(cis.PushLimit(4));
+    EXPECT_EQ(4, cis.BytesUntilLimit());
+    // Beyond the current limit
+    EXPECT_FALSE(cis.PushLimit(5));
+
+    EXPECT_TRUE(cis.PushLimit(2));
+    string str;
+    EXPECT_TRUE(cis.ReadString(str, 2));
+    EXPECT_EQ("\x02\x03", str);
+    EXPECT_TRUE(cis.ReachedLimit());
+    EXPECT_FALSE(cis.ReadVarint32(value));
+    EXPECT_FALSE(cis.Skip(1));
+    cis.PopLimit();
+
+    EXPECT_EQ(2, cis.BytesUntilLimit());
+    EXPECT_FALSE(cis.ReachedLimit());
+    // Fails without reading beyond the limit.
+    EXPECT_FALSE(cis.ReadString(str, 3));
+    EXPECT_LE(cis.ConsumedSize(), 5);
+    cis.PopLimit();
+
+    EXPECT_EQ(SIZE_MAX, cis.BytesUntilLimit());
+}
+
+}  // namespace
+
+TEST(StreamTest, LimitTest) {
+    string data = "\x01\x02\x03\x04\x05\x06";
+
+    {
+        CodedInputStream cis(
+                reinterpret_cast<const uint8_t*>(data.data()), data.size());
+        CheckLimits(cis);
+    }
+    {
+        // The limits fall on chunk boundaries and in the middle of chunks.
+        for (size_t block_size = 1; block_size <= data.size(); block_size++) {
+            StringZeroCopyInputStream ins(&data, block_size);
+            CodedInputStream cis(&ins);
+            CheckLimits(cis);
+        }
+    }
+    {
+        stringstream ss(data);
+        StlInputStream ins(&ss);
+        CodedInputStream cis(&ins);
+        CheckLimits(cis);
+    }
+}
+
+TEST(StreamTest, LimitFastPathTest) {
+    // A varint crossing the limit fails even if the buffer has enough
+    // bytes for the unrolled path.
+    string data = "\x96\x01" + string(20, '\0');
+    CodedInputStream cis(
+            reinterpret_cast<const uint8_t*>(data.data()), data.size());
+    EXPECT_TRUE(cis.PushLimit(1));
+    uint64_t value;
+    EXPECT_FALSE(cis.ReadVarint64(value));
+    cis.PopLimit();
+}
+
+TEST(StreamTest, ReadStringViewTest) {
+    string data = "testing";
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data.data());
+    {
+        CodedInputStream cis(bytes, data.size());
+        string_view result;
+        EXPECT_TRUE(cis.ReadStringView(result, 4));
+        EXPECT_EQ("test", result);
+        // Refers to the buffer
+        EXPECT_EQ(data.data(), result.data());
+        EXPECT_EQ(4, cis.ConsumedSize());
+
+        // Nothing is consumed on failure.
+        EXPECT_FALSE(cis.ReadStringView(result, 4));
+        EXPECT_EQ(4, cis.ConsumedSize());
+
+        EXPECT_TRUE(cis.PushLimit(2));
+        EXPECT_FALSE(cis.ReadStringView(result, 3));
+        EXPECT_TRUE(cis.ReadStringView(result, 2));
+        EXPECT_EQ("in", result);
+        cis.PopLimit();
+    }
+    {
+        // Chunks of a ZeroCopyInputStream can't be aliased.
+        StringZeroCopyInputStream ins(&data);
+        CodedInputStream cis(&ins);
+        string_view result;
+        EXPECT_FALSE(cis.ReadStringView(result, 4));
+        EXPECT_EQ(0, cis.ConsumedSize());
+    }
+    {
+        stringstream ss(data);
+        StlInputStream in(&ss);
+        CodedInputStream cis(&in);
+        string_view result;
+        EXPECT_FALSE(cis.ReadStringView(result, 4));
+    }
+}
+
+TEST(StreamTest, WriteRawTagTest) {
+    // Field 2048 with LEN wire type: (2048 << 3) | 2 = 16386
+    const uint8_t kTag[] = {0x82, 0x80, 0x01};
+    {
+        uint8_t buf[8];
+        CodedOutputStream cos(buf, sizeof(buf));
+        EXPECT_TRUE(cos.WriteRawTag(kTag));
+        EXPECT_EQ(3, cos.WrittenSize());
+        EXPECT_EQ(0, memcmp(kTag, buf, sizeof(kTag)));
+    }
+    {
+        // Same as WriteTag
+        string data;
+        {
+            StringOutputStream out(&data);
+            CodedOutputStream cos(&out);
+            EXPECT_TRUE(cos.WriteRawTag(kTag));
+            EXPECT_TRUE(cos.WriteTag(2048, WireType::kLen));
+        }
+        EXPECT_EQ(string("\x82\x80\x01\x82\x80\x01"), data);
+    }
+    {
+        // No room for the whole tag
+        uint8_t buf[2];
+        CodedOutputStream cos(buf, sizeof(buf));
+        EXPECT_FALSE(cos.WriteRawTag(kTag));
+        EXPECT_TRUE(cos.HadError());
+    }
+}
@@ -0,0 +1,142 @@
+#include "decaproto/stream/crc32c.h"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "decaproto/stream/array_stream.h"
+#include "decaproto/stream/coded_stream.h"
+#include "decaproto/stream/stl.h"
+
+using namespace decaproto;
+using namespace std;
+
+namespace {
+
+uint32_t Crc32c(const string& data) {
+    return decaproto::Crc32c(
+            reinterpret_cast<const uint8_t*>(data.data()), data.size());
+}
+
+string TestData(size_t size) {
+    string data;
+    for (size_t i = 0; i < size; i++) {
+        data.push_back(static_cast<char>(i * 31 + 7));
+    }
+    return data;
+}
+
+}  // namespace
+
+TEST(Crc32cTest, KnownValuesTest) {
+    // Check values from RFC 3720 (iSCSI)
+    EXPECT_EQ(0, Crc32c(""));
+    EXPECT_EQ(0xe3069283, Crc32c("123456789"));
+    EXPECT_EQ(0x8a9136aa, Crc32c(string(32, '\x00')));
+    EXPECT_EQ(0x62a8ab43, Crc32c(string(32, '\xff')));
+
+    string ascending;
+    for (int i = 0; i < 32; i++) {
+        ascending.push_back(static_cast<char>(i));
+    }
+    EXPECT_EQ(0x46dd794e, Crc32c(ascending));
+}
+
+TEST(Crc32cTest, PortableTest) {
+    // Various lengths and alignments to cover the blocks and the tail.
+    string data = TestData(100);
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data.data());
+    for (size_t offset = 0; offset < 8; offset++) {
+        for (size_t len = 0; offset + len <= data.size(); len++) {
+            EXPECT_EQ(
+                    ExtendCrc32c(0, bytes + offset, len),
+                    ExtendCrc32cPortable(0, bytes + offset, len));
+        }
+    }
+    EXPECT_EQ(
+            0xe3069283,
+            ExtendCrc32cPortable(
+                    0, reinterpret_cast<const uint8_t*>("123456789"), 9));
+}
+
+TEST(Crc32cTest, ExtendTest) {
+    string data = TestData(1000);
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data.data());
+    uint32_t expected = Crc32c(data);
+    for (size_t split : {0, 1, 7, 8, 9, 500, 999, 1000}) {
+        uint32_t crc = ExtendCrc32c(0, bytes, split);
+        EXPECT_EQ(expected, ExtendCrc32c(crc, bytes + split, 1000 - split));
+        crc = ExtendCrc32cPortable(0, bytes, split);
+        EXPECT_EQ(
+                expected,
+                ExtendCrc32cPortable(crc, bytes + split, 1000 - split));
+    }
+}
+
+TEST(Crc32cTest, OutputStreamTest) {
+    {
+        // Through Write() and WriteBytes()
+        stringstream ss;
+        StlOutputStream outs(&ss);
+        Crc32cOutputStream crc_stream(&outs);
+        {
+            CodedOutputStream cos(&crc_stream);
+            EXPECT_TRUE(cos.WriteVarint64(150));
+            EXPECT_TRUE(cos.WriteString("testing"));
+            EXPECT_TRUE(cos.WriteFixedInt32(0x67452301));
+        }
+        EXPECT_EQ(13, crc_stream.WrittenSize());
+        EXPECT_EQ(Crc32c(ss.str()), crc_stream.Crc());
+    }
+    {
+        // Through the direct buffer
+        uint8_t buf[32];
+        ArrayOutputStream outs(buf, sizeof(buf));
+        Crc32cOutputStream crc_stream(&outs);
+        {
+            CodedOutputStream cos(&crc_stream);
+            EXPECT_TRUE(cos.WriteVarint64(150));
+            EXPECT_TRUE(cos.WriteString("testing"));
+        }
+        EXPECT_EQ(9, outs.WrittenSize());
+        EXPECT_EQ(9, crc_stream.WrittenSize());
+        EXPECT_EQ(
+                Crc32c(string(reinterpret_cast<char*>(buf), 9)),
+                crc_stream.Crc());
+    }
+}
+
+TEST(Crc32cTest, InputStreamTest) {
+    string data = TestData(20);
+    // Followed by data which isn't read
+    string input = data + "rest";
+    {
+        stringstream ss(input);
+        StlInputStream ins(&ss);
+        Crc32cInputStream crc_stream(&ins);
+        {
+            CodedInputStream cis(&crc_stream);
+            // The first byte (7) is a one-byte varint.
+            uint32_t value;
+            EXPECT_TRUE(cis.ReadVarint32(value));
+            string str;
+            EXPECT_TRUE(cis.ReadString(str, 19));
+        }
+        EXPECT_EQ(20, crc_stream.ConsumedSize());
+        EXPECT_EQ(Crc32c(data), crc_stream.Crc());
+    }
+    {
+        ArrayInputStream ins(input);
+        Crc32cInputStream crc_stream(&ins);
+        {
+            CodedInputStream cis(&crc_stream);
+            string str;
+            EXPECT_TRUE(cis.ReadString(str, 10));
+            EXPECT_TRUE(cis.Skip(10));
+        }
+        EXPECT_EQ(20, crc_stream.ConsumedSize());
+        EXPECT_EQ(Crc32c(data), crc_stream.Crc());
+    }
+}
@@ -4,9 +4,12 @@
 
 #include <sstream>
 
+#include "decaproto/stream/array_stream.h"
 #include "decaproto/stream/coded_stream.h"
 #include "decaproto/stream/stl.h"
 #include "decaproto/stream/stream.h"
+#include "decaproto/stream/string_stream.h"
+#include "decaproto/stream/zero_copy_stream.h"
 #include "fake_message.h"
 
 using namespace decaproto;
@@ -191,6 +194,52 @@ TEST(DecoderTest, DecodeRepeatedUInt32FieldTest) {
     EXPECT_EQ(20, m.rep_nums()[2]);
 }
 
+TEST(DecoderTest, DecodePackedFieldTest) {
+    stringstream ss;
+    // 5: LEN 4 {10 150 20}
+    ss.put(0b0'0101'010);
+    ss.put(0x04);
+    ss.put(0x0A);
+    ss.put(0x96);
+    ss.put(0x01);
+    ss.put(0x14);
+    // 5: 30 (unpacked elements of the same field are accepted too)
+    ss.put(0b0'0101'000);
+    ss.put(0x1E);
+    // 6: LEN 2 {ENUM_B ENUM_A}
+    // rep_enums has no mutable vector, so the values are added one by one.
+    ss.put(0b0'0110'010);
+    ss.put(0x02);
+    ss.put(0x02);
+    ss.put(0x01);
+
+    StlInputStream ins(&ss);
+
+    FakeMessage m;
+    EXPECT_FALSE(m.GetDescriptor()->FindFieldByNumber(kRepNumsTag)->IsPacked());
+
+    EXPECT_TRUE(DecodeMessage(ins, &m));
+    EXPECT_EQ(vector<uint32_t>({10, 150, 20, 30}), m.rep_nums());
+    ASSERT_EQ(2, m.rep_enums_size());
+    EXPECT_EQ(FakeEnum::ENUM_B, m.get_rep_enums(0));
+    EXPECT_EQ(FakeEnum::ENUM_A, m.get_rep_enums(1));
+}
+
+TEST(DecoderTest, DecodeTruncatedPackedFieldTest) {
+    stringstream ss;
+    // 5: LEN 4 {10 150} and 1 byte missing
+    ss.put(0b0'0101'010);
+    ss.put(0x04);
+    ss.put(0x0A);
+    ss.put(0x96);
+    ss.put(0x01);
+
+    StlInputStream ins(&ss);
+
+    FakeMessage m;
+    EXPECT_FALSE(DecodeMessage(ins, &m));
+}
+
 TEST(DecoderTest, DecodeRepeatedUInt32_StringInTheMiddle_FieldTest) {
     stringstream ss;
     // tag: 2A (0 1010 010)
@@ -244,3 +293,200 @@ TEST(DecoderTest, DecodeRepeatedUInt32_StringInTheMiddle_FieldTest) {
 
     EXPECT_EQ("testing", m.str());
 }
+
+TEST(DecoderTest, DecodeFromArrayTest) {
+    // 1: 10, 3: LEN 3 {1: 150}, 2: LEN 4 "test"
+    const uint8_t data[] = {
+            0b0'0001'000,
+            0x0A,
+            0b0'0011'010,
+            0x03,
+            0x08,
+            0x96,
+            0x01,
+            0b0'0010'010,
+            0x04,
+            't',
+            'e',
+            's',
+            't'};
+    ArrayInputStream ins(data, sizeof(data));
+
+    FakeMessage m;
+    EXPECT_TRUE(DecodeMessage(ins, &m));
+    EXPECT_EQ(10, m.num());
+    EXPECT_EQ(150, m.other().num());
+    EXPECT_EQ("test", m.str());
+    EXPECT_EQ(sizeof(data), ins.Position());
+}
+
+TEST(DecoderTest, DecodeTruncatedArrayTest) {
+    // 2: LEN 7 "tes" (4 bytes are missing)
+    const uint8_t data[] = {0b0'0010'010, 0x07, 't', 'e', 's'};
+    ArrayInputStream ins(data, sizeof(data));
+
+    FakeMessage m;
+    EXPECT_FALSE(DecodeMessage(ins, &m));
+}
+
+TEST(DecoderTest, SkipUnknownLenFieldTest) {
+    // 15: LEN 3 "abc" (unknown), 1: 10
+    const uint8_t data[] = {0b0'1111'010, 0x03, 'a', 'b', 'c', 0x08, 0x0A};
+
+    // Skipped in the buffer
+    ArrayInputStream array_ins(data, sizeof(data));
+    FakeMessage m;
+    EXPECT_TRUE(DecodeMessage(array_ins, &m));
+    EXPECT_EQ(10, m.num());
+
+    // Skipped by InputStream::Skip()
+    stringstream ss(string(reinterpret_cast<const char*>(data), sizeof(data)));
+    StlInputStream stl_ins(&ss);
+    FakeMessage m2;
+    EXPECT_TRUE(DecodeMessage(stl_ins, &m2));
+    EXPECT_EQ(10, m2.num());
+}
+
+TEST(DecoderTest, SkipTruncatedUnknownFieldTest) {
+    // 15: LEN 100 "abc" (97 bytes are missing)
+    const uint8_t data[] = {0b0'1111'010, 100, 'a', 'b', 'c'};
+
+    ArrayInputStream array_ins(data, sizeof(data));
+    FakeMessage m;
+    EXPECT_FALSE(DecodeMessage(array_ins, &m));
+
+    stringstream ss(string(reinterpret_cast<const char*>(data), sizeof(data)));
+    StlInputStream stl_ins(&ss);
+    FakeMessage m2;
+    EXPECT_FALSE(DecodeMessage(stl_ins, &m2));
+}
+
+TEST(DecoderTest, FieldOverrunsSubMessageTest) {
+    // 3: LEN 3 {2: LEN 4 "test"} 2: LEN 1 "a"
+    // The string in the sub message goes beyond the sub message.
+    const uint8_t data[] = {
+            0b0'0011'010,
+            0x03,
+            0b0'0010'010,
+            0x04,
+            't',
+            'e',
+            's',
+            't',
+            0b0'0010'010,
+            0x01,
+            'a'};
+    ArrayInputStream ins(data, sizeof(data));
+
+    FakeMessage m;
+    EXPECT_FALSE(DecodeMessage(ins, &m));
+}
+
+TEST(DecoderTest, DecodeAliasingTest) {
+    FakeMessage src;
+    src.set_num(150);
+    src.set_str("testing");
+    string encoded;
+    {
+        StringOutputStream out(&encoded);
+        CodedOutputStream cos(&out);
+        EXPECT_TRUE(src.EncodeImpl(cos));
+    }
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(encoded.data());
+
+    FakeMessage m;
+    EXPECT_TRUE(DecodeMessageAliasing(bytes, encoded.size(), &m));
+    EXPECT_EQ(150, m.num());
+    // The string refers to the encoded bytes.
+    EXPECT_EQ("testing", m.str_view());
+    EXPECT_EQ(encoded.data() + 5, m.str_view().data());
+
+    // Encoding the aliased message gives the same bytes.
+    EXPECT_EQ(src.ComputeEncodedSize(), m.ComputeEncodedSize());
+    string reencoded;
+    {
+        StringOutputStream out(&reencoded);
+        CodedOutputStream cos(&out);
+        EXPECT_TRUE(m.EncodeImpl(cos));
+    }
+    EXPECT_EQ(encoded, reencoded);
+
+    // Reflection reads the aliased bytes through str_view().
+    EXPECT_EQ("testing",
+            m.GetReflection()->GetStringView(&m, kStrTag));
+
+    // str() refuses to read the aliased bytes, and mutable_str() copies them.
+    EXPECT_DEBUG_DEATH(m.str(), "str_view");
+    EXPECT_EQ("testing", *m.mutable_str());
+    EXPECT_EQ("testing", m.str());
+    EXPECT_NE(encoded.data() + 5, m.str_view().data());
+    EXPECT_EQ("testing", m.str_view());
+}
+
+TEST(DecoderTest, DecodeAliasingFallbackTest) {
+    FakeMessage src;
+    src.set_str("testing");
+    string encoded;
+    {
+        StringOutputStream out(&encoded);
+        CodedOutputStream cos(&out);
+        EXPECT_TRUE(src.EncodeImpl(cos));
+    }
+
+    // Chunks can't be aliased, so the string is copied.
+    StringZeroCopyInputStream ins(&encoded, 3);
+    CodedInputStream cis(&ins);
+    cis.EnableAliasing(true);
+    FakeMessage m;
+    EXPECT_TRUE(DecodeMessage(
+            cis, SIZE_MAX, &m, m.GetReflection(), m.GetDescriptor()));
+    EXPECT_EQ("testing", m.str_view());
+    EXPECT_EQ("testing", m.str());
+}
+
+namespace {
+
+// Decodes with its own DecodeImpl() while counting the calls.
+class CountingMessage : public FakeMessage {
+public:
+    int decode_calls = 0;
+
+    bool DecodeImpl(CodedInputStream& stream) override {
+        decode_calls++;
+        return FakeMessage::DecodeImpl(stream);
+    }
+};
+
+}  // namespace
+
+TEST(DecoderTest, DecodeImplDispatchTest) {
+    FakeMessage src;
+    src.set_num(150);
+    string encoded;
+    {
+        StringOutputStream out(&encoded);
+        CodedOutputStream cos(&out);
+        EXPECT_TRUE(src.EncodeImpl(cos));
+    }
+
+    {
+        CountingMessage m;
+        CodedInputStream cis(
+                reinterpret_cast<const uint8_t*>(encoded.data()),
+                encoded.size());
+        EXPECT_TRUE(DecodeMessage(cis, encoded.size(), &m));
+        EXPECT_EQ(1, m.decode_calls);
+        EXPECT_EQ(150, m.num());
+    }
+    {
+        // The reflection path doesn't go through DecodeImpl()
+        CountingMessage m;
+        CodedInputStream cis(
+                reinterpret_cast<const uint8_t*>(encoded.data()),
+                encoded.size());
+        EXPECT_TRUE(DecodeMessage(
+                cis, encoded.size(), &m, m.GetReflection(), m.GetDescriptor()));
+        EXPECT_EQ(0, m.decode_calls);
+        EXPECT_EQ(150, m.num());
+    }
+}
@@ -0,0 +1,116 @@
+#include "decaproto/delimited.h"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+#include "decaproto/stream/array_stream.h"
+#include "decaproto/stream/stl.h"
+#include "decaproto/stream/string_stream.h"
+#include "fake_message.h"
+
+using namespace decaproto;
+using namespace std;
+
+TEST(DelimitedTest, EncodeDecodeTest) {
+    FakeMessage src1;
+    src1.set_num(10);
+    src1.set_str("test");
+    FakeMessage src2;
+    src2.mutable_other()->set_num(150);
+
+    string encoded;
+    StringOutputStream outs(&encoded);
+    EXPECT_TRUE(EncodeDelimited(src1, outs));
+    EXPECT_TRUE(EncodeDelimited(src2, outs));
+    EXPECT_EQ(
+            2 + src1.ComputeEncodedSize() + src2.ComputeEncodedSize(),
+            encoded.size());
+
+    stringstream ss(encoded);
+    StlInputStream ins(&ss);
+    FakeMessage m1;
+    EXPECT_TRUE(DecodeDelimited(ins, &m1));
+    EXPECT_EQ(10, m1.num());
+    EXPECT_EQ("test", m1.str());
+    EXPECT_FALSE(m1.has_other());
+
+    FakeMessage m2;
+    EXPECT_TRUE(DecodeDelimited(ins, &m2));
+    EXPECT_EQ(0, m2.num());
+    EXPECT_EQ(150, m2.other().num());
+}
+
+TEST(DelimitedTest, ReaderTest) {
+    string encoded;
+    StringOutputStream outs(&encoded);
+    for (uint32_t i = 0; i < 100; i++) {
+        FakeMessage src;
+        src.set_num(i);
+        src.add_rep_nums();
+        EXPECT_TRUE(EncodeDelimited(src, outs));
+    }
+
+    ArrayInputStream ins(encoded);
+    DelimitedReader reader(&ins);
+    FakeMessage m;
+    uint32_t count = 0;
+    while (reader.Next(&m)) {
+        EXPECT_EQ(count, m.num());
+        // The message must be cleared for each record
+        EXPECT_EQ(1, m.rep_nums_size());
+        count++;
+    }
+    EXPECT_EQ(100, count);
+    EXPECT_FALSE(reader.HadError());
+    EXPECT_EQ(encoded.size(), reader.ConsumedSize());
+}
+
+TEST(DelimitedTest, EmptyMessageTest) {
+    // Two empty messages
+    const uint8_t data[] = {0x00, 0x00};
+    DelimitedReader reader(data, sizeof(data));
+
+    FakeMessage m;
+    EXPECT_TRUE(reader.Next(&m));
+    EXPECT_TRUE(reader.Next(&m));
+    EXPECT_FALSE(reader.Next(&m));
+    EXPECT_FALSE(reader.HadError());
+}
+
+TEST(DelimitedTest, TruncatedMessageTest) {
+    // LEN 6, 2: LEN 4 "te" (2 bytes are missing)
+    const uint8_t data[] = {0x06, 0b0'0010'010, 0x04, 't', 'e'};
+    DelimitedReader reader(data, sizeof(data));
+
+    FakeMessage m;
+    EXPECT_FALSE(reader.Next(&m));
+    EXPECT_TRUE(reader.HadError());
+}
+
+TEST(DelimitedTest, TruncatedSizeTest) {
+    // The varint size is cut in the middle
+    const uint8_t data[] = {0x96};
+    DelimitedReader reader(data, sizeof(data));
+
+    FakeMessage m;
+    EXPECT_FALSE(reader.Next(&m));
+    EXPECT_TRUE(reader.HadError());
+}
+
+TEST(DelimitedTest, HugeSizeTest) {
+    // The size is UINT64_MAX, followed by 1: VARINT 150
+    const string data(
+            "\xff\xff\xff\xff\xff\xff\xff\xff\xff\x01"
+            "\x08\x96\x01");
+
+    // Must not be taken as "decode until the end of the stream"
+    ArrayInputStream ins(data);
+    FakeMessage m;
+    EXPECT_FALSE(DecodeDelimited(ins, &m));
+
+    ArrayInputStream reader_ins(data);
+    DelimitedReader reader(&reader_ins);
+    EXPECT_FALSE(reader.Next(&m));
+    EXPECT_TRUE(reader.HadError());
+}
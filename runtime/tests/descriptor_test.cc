@@ -0,0 +1,61 @@
+#include "decaproto/descriptor.h"
+
+#include <gtest/gtest.h>
+
+using namespace decaproto;
+
+TEST(DescriptorTest, FindFieldByNumberTest) {
+    Descriptor descriptor;
+    // Not in the order of field numbers, with a gap
+    descriptor.RegisterField(FieldDescriptor(3, kString));
+    descriptor.RegisterField(FieldDescriptor(1, kInt32));
+    descriptor.RegisterField(FieldDescriptor(5, kMessage, true));
+
+    ASSERT_NE(nullptr, descriptor.FindFieldByNumber(1));
+    EXPECT_EQ(kInt32, descriptor.FindFieldByNumber(1)->GetType());
+    ASSERT_NE(nullptr, descriptor.FindFieldByNumber(3));
+    EXPECT_EQ(kString, descriptor.FindFieldByNumber(3)->GetType());
+    ASSERT_NE(nullptr, descriptor.FindFieldByNumber(5));
+    EXPECT_TRUE(descriptor.FindFieldByNumber(5)->IsRepeated());
+
+    EXPECT_EQ(nullptr, descriptor.FindFieldByNumber(0));
+    EXPECT_EQ(nullptr, descriptor.FindFieldByNumber(2));
+    EXPECT_EQ(nullptr, descriptor.FindFieldByNumber(6));
+    EXPECT_EQ(nullptr, descriptor.FindFieldByNumber(UINT32_MAX));
+}
+
+TEST(DescriptorTest, SparseFieldNumbersTest) {
+    Descriptor descriptor;
+    descriptor.RegisterField(FieldDescriptor(536870911, kInt32));
+    descriptor.RegisterField(FieldDescriptor(2, kString));
+    descriptor.RegisterField(FieldDescriptor(100000, kFixed32, true));
+    descriptor.RegisterField(FieldDescriptor(2048, kUint64));
+
+    ASSERT_NE(nullptr, descriptor.FindFieldByNumber(536870911));
+    EXPECT_EQ(kInt32, descriptor.FindFieldByNumber(536870911)->GetType());
+    ASSERT_NE(nullptr, descriptor.FindFieldByNumber(2));
+    EXPECT_EQ(kString, descriptor.FindFieldByNumber(2)->GetType());
+    ASSERT_NE(nullptr, descriptor.FindFieldByNumber(100000));
+    EXPECT_EQ(kFixed32, descriptor.FindFieldByNumber(100000)->GetType());
+    ASSERT_NE(nullptr, descriptor.FindFieldByNumber(2048));
+    EXPECT_EQ(kUint64, descriptor.FindFieldByNumber(2048)->GetType());
+
+    EXPECT_EQ(nullptr, descriptor.FindFieldByNumber(1));
+    EXPECT_EQ(nullptr, descriptor.FindFieldByNumber(2047));
+    EXPECT_EQ(nullptr, descriptor.FindFieldByNumber(536870910));
+}
+
+TEST(DescriptorTest, ManyFieldsTest) {
+    Descriptor descriptor;
+    for (uint32_t i = 64; i > 0; i--) {
+        descriptor.RegisterField(
+                FieldDescriptor(i, i % 2 == 0 ? kInt32 : kString));
+    }
+    EXPECT_EQ(64, descriptor.GetFields().size());
+    for (uint32_t i = 1; i <= 64; i++) {
+        const FieldDescriptor* field = descriptor.FindFieldByNumber(i);
+        ASSERT_NE(nullptr, field);
+        EXPECT_EQ(i, field->GetFieldNumber());
+    }
+    EXPECT_EQ(nullptr, descriptor.FindFieldByNumber(65));
+}
@@ -4,6 +4,7 @@
 
 #include <sstream>
 
+#include "decaproto/stream/array_stream.h"
 #include "decaproto/stream/coded_stream.h"
 #include "decaproto/stream/stl.h"
 #include "decaproto/stream/stream.h"
@@ -138,3 +139,36 @@ TEST(EncoderTest, EncodeSubMessageTest) {
     EXPECT_EQ(0x96, ss.get());
     EXPECT_EQ(0x01, ss.get());
 }
+
+TEST(EncoderTest, EncodeToArrayTest) {
+    uint8_t buf[16];
+    ArrayOutputStream outs(buf, sizeof(buf));
+
+    FakeMessage m;
+    m.set_num(150);
+    m.set_str("testing");
+
+    size_t written_size;
+    EXPECT_TRUE(m.Encode(outs, written_size));
+    EXPECT_EQ(12, written_size);
+    EXPECT_EQ(12, outs.WrittenSize());
+
+    const uint8_t expected[] = {
+            0x08, 0x96, 0x01, 0x12, 0x07, 't', 'e', 's', 't', 'i', 'n', 'g'};
+    EXPECT_EQ(0, memcmp(expected, buf, sizeof(expected)));
+}
+
+TEST(EncoderTest, EncodeOverflowTest) {
+    uint8_t buf[8];
+    ArrayOutputStream outs(buf, sizeof(buf));
+
+    FakeMessage m;
+    m.set_num(150);
+    m.set_str("testing");
+
+    // The string doesn't fit. EncodeImpl doesn't check each write, but the
+    // error is reported by Encode.
+    size_t written_size;
+    EXPECT_FALSE(m.Encode(outs, written_size));
+    EXPECT_LE(written_size, sizeof(buf));
+}
@@ -9,10 +9,10 @@ bool FakeMessage::EncodeImpl(decaproto::CodedOutputStream& stream) const {
         stream.WriteVarint32(num_);
     }
 
-    if (!str_.empty()) {
+    if (!str_view().empty()) {
         stream.WriteTag(kStrTag, decaproto::WireType::kLen);
-        stream.WriteVarint32(str_.size());
-        stream.WriteString(str_);
+        stream.WriteVarint32(str_view().size());
+        stream.WriteString(str_view());
     }
 
     if (has_other_) {
@@ -37,7 +37,7 @@ bool FakeMessage::EncodeImpl(decaproto::CodedOutputStream& stream) const {
         stream.WriteVarint32(static_cast<uint32_t>(e));
     }
 
-    return true;
+    return !stream.HadError();
 }
 
 Descriptor* kTestDescriptor = nullptr;
@@ -81,6 +81,10 @@ const Reflection* FakeMessage::GetReflection() const {
     kTestReflection->RegisterMutableString(
             kStrTag, MsgCast(&FakeMessage::mutable_str));
     kTestReflection->RegisterGetString(kStrTag, MsgCast(&FakeMessage::str));
+    kTestReflection->RegisterGetStringView(
+            kStrTag, MsgCast(&FakeMessage::str_view));
+    kTestReflection->RegisterSetStringView(
+            kStrTag, MsgCast(&FakeMessage::set_str_alias));
 
     // OtherMessage other = 3
     kTestReflection->RegisterMutableMessage(
@@ -101,6 +105,8 @@ const Reflection* FakeMessage::GetReflection() const {
             kRepNumsTag, MsgCast(&FakeMessage::get_rep_nums));
     kTestReflection->RegisterAddRepeatedUint32(
             kRepNumsTag, MsgCast(&FakeMessage::add_rep_nums));
+    kTestReflection->RegisterMutableRepeatedUint32Field(
+            kRepNumsTag, MsgCast(&FakeMessage::mutable_rep_nums));
     kTestReflection->RegisterFieldSize(
             kRepNumsTag, MsgCast(&FakeMessage::rep_nums_size));
 
@@ -122,7 +128,7 @@ bool FakeOtherMessage::EncodeImpl(decaproto::CodedOutputStream& stream) const {
         stream.WriteVarint32(num_);
     }
 
-    return true;
+    return !stream.HadError();
 }
 
 Descriptor* kFakeOtherDescriptor = nullptr;
@@ -1,7 +1,9 @@
 #ifndef FAKE_MESSAGE_H
 #define FAKE_MESSAGE_H
 
+#include <cassert>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "decaproto/descriptor.h"
@@ -35,6 +37,10 @@ public:
         num_ = num;
     }
 
+    void Clear() override {
+        num_ = 0;
+    }
+
     virtual size_t ComputeEncodedSize() const override {
         size_t size = 0;
         if (num_ != 0) {
@@ -61,7 +67,9 @@ class FakeMessage : public decaproto::Message {
     uint32_t num_;
 
     // string str = 2
+    // str_view_ is set while str refers to the input buffer.
     std::string str_;
+    std::string_view str_view_;
 
     // OtherMessage other = 3
     mutable decaproto::SubMessagePtr<FakeOtherMessage> other_;
@@ -80,6 +88,7 @@ public:
     FakeMessage()
         : num_(0),
           str_(""),
+          str_view_(),
           other_(nullptr),
           has_other_(false),
           enum_field_(FakeEnum::UNKNOWN) {
@@ -98,13 +107,32 @@ public:
 
     void set_str(const std::string& str) {
         str_ = str;
+        str_view_ = std::string_view();
+    }
+
+    void set_str_alias(std::string_view str) {
+        str_.clear();
+        str_view_ = str;
     }
 
+    // Must not be called while str refers to the input buffer
     const std::string& str() const {
+        assert(str_view_.data() == nullptr && "Use str_view() instead.");
+        return str_;
+    }
+
+    std::string_view str_view() const {
+        if (str_view_.data() != nullptr) {
+            return str_view_;
+        }
         return str_;
     }
 
     std::string* mutable_str() {
+        if (str_view_.data() != nullptr) {
+            str_.assign(str_view_.data(), str_view_.size());
+            str_view_ = std::string_view();
+        }
         return &str_;
     }
 
@@ -190,6 +218,16 @@ public:
         return rep_enums_.size();
     }
 
+    void Clear() override {
+        num_ = 0;
+        str_.clear();
+        str_view_ = std::string_view();
+        clear_other();
+        enum_field_ = FakeEnum::UNKNOWN;
+        rep_nums_.clear();
+        rep_enums_.clear();
+    }
+
     virtual bool EncodeImpl(
             decaproto::CodedOutputStream& stream) const override;
     virtual size_t ComputeEncodedSize() const override {
@@ -199,10 +237,10 @@ public:
             size += decaproto::ComputeEncodedVarintSize(num_);
         }
 
-        if (str_ != std::string()) {
+        if (!str_view().empty()) {
             size += 1;  // tag
-            size += decaproto::ComputeEncodedVarintSize(str_.size());
-            size += str_.size();
+            size += decaproto::ComputeEncodedVarintSize(str_view().size());
+            size += str_view().size();
         }
 
         if (has_other_) {
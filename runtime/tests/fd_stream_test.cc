@@ -0,0 +1,157 @@
+#include "decaproto/stream/fd_stream.h"
+
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <cstdio>
+
+#include "decaproto/decoder.h"
+#include "decaproto/stream/coded_stream.h"
+#include "fake_message.h"
+
+using namespace decaproto;
+using namespace std;
+
+namespace {
+
+class Pipe {
+public:
+    int fds[2];
+
+    Pipe() {
+        EXPECT_EQ(0, pipe(fds));
+    }
+
+    ~Pipe() {
+        close(fds[0]);
+        CloseWriteEnd();
+    }
+
+    void CloseWriteEnd() {
+        if (fds[1] >= 0) {
+            close(fds[1]);
+            fds[1] = -1;
+        }
+    }
+};
+
+}  // namespace
+
+TEST(FdStreamTest, WriteReadTest) {
+    Pipe p;
+    {
+        FdOutputStream outs(p.fds[1], 4);
+        CodedOutputStream cos(&outs);
+        EXPECT_TRUE(cos.WriteVarint32(150));
+        // Doesn't fit in the buffer
+        EXPECT_TRUE(cos.WriteString("hello world"));
+        EXPECT_TRUE(cos.WriteFixedInt32(0x04030201));
+        EXPECT_EQ(17, cos.WrittenSize());
+        EXPECT_EQ(17, outs.ByteCount());
+    }
+    p.CloseWriteEnd();
+
+    FdInputStream ins(p.fds[0], 4);
+    CodedInputStream cis(&ins);
+    uint32_t varint;
+    EXPECT_TRUE(cis.ReadVarint32(varint));
+    EXPECT_EQ(150, varint);
+    string str;
+    EXPECT_TRUE(cis.ReadString(str, 11));
+    EXPECT_EQ("hello world", str);
+    uint32_t fixed;
+    EXPECT_TRUE(cis.ReadFixedInt32(fixed));
+    EXPECT_EQ(0x04030201, fixed);
+    EXPECT_EQ(17, ins.ByteCount());
+
+    EXPECT_FALSE(cis.ReadVarint32(varint));
+    EXPECT_EQ(0, ins.GetErrno());
+}
+
+TEST(FdStreamTest, ShortReadTest) {
+    Pipe p;
+    EXPECT_EQ(3, write(p.fds[1], "abc", 3));
+    p.CloseWriteEnd();
+
+    FdInputStream ins(p.fds[0]);
+    uint8_t buf[8];
+    EXPECT_FALSE(ins.ReadBytes(buf, sizeof(buf)));
+    EXPECT_EQ(3, ins.ByteCount());
+    EXPECT_EQ('c', buf[2]);
+}
+
+TEST(FdStreamTest, EncodeDecodeTest) {
+    FakeMessage src;
+    src.set_num(10);
+    src.set_str("test");
+    src.mutable_other()->set_num(150);
+
+    Pipe p;
+    size_t written_size;
+    {
+        FdOutputStream outs(p.fds[1]);
+        EXPECT_TRUE(src.Encode(outs, written_size));
+        EXPECT_EQ(written_size, outs.ByteCount());
+    }
+    p.CloseWriteEnd();
+
+    FdInputStream ins(p.fds[0]);
+    FakeMessage m;
+    EXPECT_TRUE(DecodeMessage(ins, &m));
+    EXPECT_EQ(10, m.num());
+    EXPECT_EQ("test", m.str());
+    EXPECT_EQ(150, m.other().num());
+    EXPECT_EQ(written_size, ins.ByteCount());
+}
+
+TEST(FdStreamTest, WriteErrorTest) {
+    FdOutputStream outs(-1, 4);
+    const uint8_t data[8] = {};
+    EXPECT_FALSE(outs.WriteBytes(data, sizeof(data)));
+    EXPECT_EQ(EBADF, outs.GetErrno());
+}
+
+TEST(FdStreamTest, SkipFileTest) {
+    string path = testing::TempDir() + "fd_stream_skip_test.bin";
+    FILE* fp = fopen(path.c_str(), "wb");
+    ASSERT_NE(nullptr, fp);
+    for (int i = 0; i < 256; i++) {
+        fputc(i, fp);
+    }
+    fclose(fp);
+
+    int fd = open(path.c_str(), O_RDONLY);
+    ASSERT_GE(fd, 0);
+    {
+        // Smaller blocks than the skips so that lseek(2) is used.
+        FdInputStream ins(fd, 16);
+        uint8_t b;
+        EXPECT_TRUE(ins.Read(b));
+        EXPECT_EQ(0, b);
+        EXPECT_TRUE(ins.Skip(100));
+        EXPECT_TRUE(ins.Read(b));
+        EXPECT_EQ(101, b);
+        EXPECT_EQ(102, ins.ByteCount());
+
+        // Beyond the end of the file
+        EXPECT_FALSE(ins.Skip(200));
+        EXPECT_EQ(256, ins.ByteCount());
+        EXPECT_FALSE(ins.Read(b));
+    }
+    close(fd);
+    remove(path.c_str());
+}
+
+TEST(FdStreamTest, SkipPipeTest) {
+    Pipe p;
+    EXPECT_EQ(5, write(p.fds[1], "abcde", 5));
+    p.CloseWriteEnd();
+
+    FdInputStream ins(p.fds[0], 2);
+    EXPECT_TRUE(ins.Skip(3));
+    uint8_t b;
+    EXPECT_TRUE(ins.Read(b));
+    EXPECT_EQ('d', b);
+    EXPECT_FALSE(ins.Skip(2));
+}
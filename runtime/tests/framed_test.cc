@@ -0,0 +1,130 @@
+#include "decaproto/framed.h"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+#include "decaproto/stream/array_stream.h"
+#include "decaproto/stream/crc32c.h"
+#include "decaproto/stream/stl.h"
+#include "decaproto/stream/string_stream.h"
+#include "fake_message.h"
+
+using namespace decaproto;
+using namespace std;
+
+TEST(FramedTest, EncodeDecodeTest) {
+    FakeMessage src1;
+    src1.set_num(10);
+    src1.set_str("test");
+    FakeMessage src2;
+    src2.mutable_other()->set_num(150);
+
+    string encoded;
+    StringOutputStream outs(&encoded);
+    EXPECT_TRUE(EncodeFramed(src1, outs));
+    EXPECT_TRUE(EncodeFramed(src2, outs));
+    // size(1) + payload + crc(4) for each record
+    EXPECT_EQ(
+            10 + src1.ComputeEncodedSize() + src2.ComputeEncodedSize(),
+            encoded.size());
+
+    // The checksum follows the payload.
+    size_t size1 = src1.ComputeEncodedSize();
+    uint32_t crc = Crc32c(
+            reinterpret_cast<const uint8_t*>(encoded.data()) + 1, size1);
+    const uint8_t* crc_bytes =
+            reinterpret_cast<const uint8_t*>(encoded.data()) + 1 + size1;
+    EXPECT_EQ(crc & 0xff, crc_bytes[0]);
+    EXPECT_EQ(crc >> 24, crc_bytes[3]);
+
+    stringstream ss(encoded);
+    StlInputStream ins(&ss);
+    FakeMessage m1;
+    EXPECT_TRUE(DecodeFramed(ins, &m1));
+    EXPECT_EQ(10, m1.num());
+    EXPECT_EQ("test", m1.str());
+
+    FakeMessage m2;
+    EXPECT_TRUE(DecodeFramed(ins, &m2));
+    EXPECT_EQ(150, m2.other().num());
+
+    FakeMessage m3;
+    EXPECT_FALSE(DecodeFramed(ins, &m3));
+}
+
+TEST(FramedTest, DirectBufferTest) {
+    FakeMessage src;
+    src.set_num(42);
+    src.set_str("direct");
+
+    uint8_t buf[64];
+    ArrayOutputStream outs(buf, sizeof(buf));
+    EXPECT_TRUE(EncodeFramed(src, outs));
+    EXPECT_TRUE(EncodeFramed(src, outs));
+
+    ArrayInputStream ins(buf, outs.WrittenSize());
+    for (int i = 0; i < 2; i++) {
+        FakeMessage m;
+        EXPECT_TRUE(DecodeFramed(ins, &m));
+        EXPECT_EQ(42, m.num());
+        EXPECT_EQ("direct", m.str());
+    }
+}
+
+TEST(FramedTest, CorruptedTest) {
+    FakeMessage src;
+    src.set_num(10);
+    src.set_str("test");
+
+    string encoded;
+    StringOutputStream outs(&encoded);
+    EXPECT_TRUE(EncodeFramed(src, outs));
+
+    // Flip a bit of the string, which is still a valid message.
+    string corrupted = encoded;
+    corrupted[corrupted.size() - 5] ^= 0x01;
+    {
+        ArrayInputStream ins(corrupted);
+        FakeMessage m;
+        EXPECT_FALSE(DecodeFramed(ins, &m));
+    }
+    // Broken checksum
+    corrupted = encoded;
+    corrupted.back() ^= 0x80;
+    {
+        ArrayInputStream ins(corrupted);
+        FakeMessage m;
+        EXPECT_FALSE(DecodeFramed(ins, &m));
+    }
+    // Truncated checksum
+    corrupted = encoded;
+    corrupted.pop_back();
+    {
+        ArrayInputStream ins(corrupted);
+        FakeMessage m;
+        EXPECT_FALSE(DecodeFramed(ins, &m));
+    }
+}
+
+TEST(FramedTest, OverflowTest) {
+    FakeMessage src;
+    src.set_str("this doesn't fit");
+
+    uint8_t buf[8];
+    ArrayOutputStream outs(buf, sizeof(buf));
+    EXPECT_FALSE(EncodeFramed(src, outs));
+}
+
+TEST(FramedTest, HugeSizeTest) {
+    // The size is UINT64_MAX, followed by 1: VARINT 150
+    const string data(
+            "\xff\xff\xff\xff\xff\xff\xff\xff\xff\x01"
+            "\x08\x96\x01");
+
+    // Must not be taken as "decode until the end of the stream"
+    ArrayInputStream ins(data);
+    FakeMessage m;
+    EXPECT_FALSE(DecodeFramed(ins, &m));
+    EXPECT_EQ(0, m.num());
+}
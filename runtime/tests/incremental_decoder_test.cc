@@ -0,0 +1,167 @@
+#include "decaproto/incremental_decoder.h"
+
+#include <gtest/gtest.h>
+
+#include "decaproto/stream/string_stream.h"
+#include "fake_message.h"
+
+using namespace decaproto;
+using namespace std;
+
+namespace {
+
+string EncodeFakeMessage() {
+    FakeMessage src;
+    src.set_num(300);
+    src.set_str("hello world");
+    src.mutable_other()->set_num(150);
+    src.set_enum_field(FakeEnum::ENUM_B);
+    src.add_rep_nums();
+    src.set_rep_nums(0, 1);
+    src.add_rep_nums();
+    src.set_rep_nums(1, 100000);
+
+    string encoded;
+    StringOutputStream outs(&encoded);
+    size_t written_size;
+    EXPECT_TRUE(src.Encode(outs, written_size));
+    return encoded;
+}
+
+void ExpectDecoded(const FakeMessage& m) {
+    EXPECT_EQ(300, m.num());
+    EXPECT_EQ("hello world", m.str());
+    EXPECT_EQ(150, m.other().num());
+    EXPECT_EQ(FakeEnum::ENUM_B, m.enum_field());
+    EXPECT_EQ(2, m.rep_nums_size());
+    EXPECT_EQ(1, m.get_rep_nums(0));
+    EXPECT_EQ(100000, m.get_rep_nums(1));
+}
+
+}  // namespace
+
+TEST(IncrementalDecoderTest, WholeDataTest) {
+    string encoded = EncodeFakeMessage();
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(encoded.data());
+
+    FakeMessage m;
+    IncrementalDecoder decoder(&m);
+    EXPECT_EQ(IncrementalDecoder::kNeedMoreData,
+              decoder.Feed(data, encoded.size()));
+    EXPECT_EQ(IncrementalDecoder::kDone, decoder.Finish());
+    ExpectDecoded(m);
+}
+
+TEST(IncrementalDecoderTest, FragmentedDataTest) {
+    string encoded = EncodeFakeMessage();
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(encoded.data());
+
+    // Every fragment size must produce the same result
+    for (size_t fragment = 1; fragment <= encoded.size(); fragment++) {
+        FakeMessage m;
+        IncrementalDecoder decoder(&m);
+        for (size_t i = 0; i < encoded.size(); i += fragment) {
+            size_t len = min(fragment, encoded.size() - i);
+            EXPECT_EQ(IncrementalDecoder::kNeedMoreData,
+                      decoder.Feed(data + i, len));
+        }
+        EXPECT_EQ(encoded.size(), decoder.ConsumedSize());
+        EXPECT_EQ(IncrementalDecoder::kDone, decoder.Finish());
+        ExpectDecoded(m);
+    }
+}
+
+TEST(IncrementalDecoderTest, SizedMessageTest) {
+    string encoded = EncodeFakeMessage();
+    // Trailing bytes which belong to the next message
+    string data = encoded + "\x08\x01";
+    const uint8_t* ptr = reinterpret_cast<const uint8_t*>(data.data());
+
+    FakeMessage m;
+    IncrementalDecoder decoder(&m, encoded.size());
+    EXPECT_EQ(IncrementalDecoder::kNeedMoreData, decoder.Feed(ptr, 3));
+    EXPECT_EQ(IncrementalDecoder::kDone,
+              decoder.Feed(ptr + 3, data.size() - 3));
+    EXPECT_EQ(encoded.size(), decoder.ConsumedSize());
+    ExpectDecoded(m);
+}
+
+TEST(IncrementalDecoderTest, TruncatedDataTest) {
+    string encoded = EncodeFakeMessage();
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(encoded.data());
+
+    FakeMessage m;
+    IncrementalDecoder decoder(&m);
+    EXPECT_EQ(IncrementalDecoder::kNeedMoreData,
+              decoder.Feed(data, encoded.size() - 1));
+    EXPECT_EQ(IncrementalDecoder::kError, decoder.Finish());
+}
+
+TEST(IncrementalDecoderTest, SubMessageOverrunTest) {
+    // 3: LEN 1 {1: 150} (the sub message is longer than its size)
+    const uint8_t data[] = {0b0'0011'010, 0x01, 0x08, 0x96, 0x01};
+
+    FakeMessage m;
+    IncrementalDecoder decoder(&m);
+    EXPECT_EQ(IncrementalDecoder::kError, decoder.Feed(data, sizeof(data)));
+    EXPECT_EQ(IncrementalDecoder::kError,
+              decoder.Feed(data, sizeof(data)));
+}
+
+TEST(IncrementalDecoderTest, UnknownFieldTest) {
+    // 15: LEN 2 "ab", 1: 10
+    const uint8_t data[] = {0b0'1111'010, 0x02, 'a', 'b', 0b0'0001'000, 0x0A};
+
+    FakeMessage m;
+    IncrementalDecoder decoder(&m);
+    for (size_t i = 0; i < sizeof(data); i++) {
+        EXPECT_EQ(IncrementalDecoder::kNeedMoreData,
+                  decoder.Feed(data + i, 1));
+    }
+    EXPECT_EQ(IncrementalDecoder::kDone, decoder.Finish());
+    EXPECT_EQ(10, m.num());
+}
+
+TEST(IncrementalDecoderTest, PackedFieldTest) {
+    // 5: LEN 4 {10 150 20}, 5: 30, 6: LEN 2 {ENUM_B ENUM_A}, 1: 10
+    const uint8_t data[] = {0b0'0101'010,
+                            0x04,
+                            0x0A,
+                            0x96,
+                            0x01,
+                            0x14,
+                            0b0'0101'000,
+                            0x1E,
+                            0b0'0110'010,
+                            0x02,
+                            0x02,
+                            0x01,
+                            0b0'0001'000,
+                            0x0A};
+
+    // Elements of packed fields may be split across fragments
+    for (size_t fragment = 1; fragment <= sizeof(data); fragment++) {
+        FakeMessage m;
+        IncrementalDecoder decoder(&m);
+        for (size_t i = 0; i < sizeof(data); i += fragment) {
+            size_t len = min(fragment, sizeof(data) - i);
+            EXPECT_EQ(IncrementalDecoder::kNeedMoreData,
+                      decoder.Feed(data + i, len));
+        }
+        EXPECT_EQ(IncrementalDecoder::kDone, decoder.Finish());
+        EXPECT_EQ(vector<uint32_t>({10, 150, 20, 30}), m.rep_nums());
+        ASSERT_EQ(2, m.rep_enums_size());
+        EXPECT_EQ(FakeEnum::ENUM_B, m.get_rep_enums(0));
+        EXPECT_EQ(FakeEnum::ENUM_A, m.get_rep_enums(1));
+        EXPECT_EQ(10, m.num());
+    }
+}
+
+TEST(IncrementalDecoderTest, PackedFieldOverrunTest) {
+    // 5: LEN 1 {150} (the last element is longer than the packed field)
+    const uint8_t data[] = {0b0'0101'010, 0x01, 0x96, 0x01};
+
+    FakeMessage m;
+    IncrementalDecoder decoder(&m);
+    EXPECT_EQ(IncrementalDecoder::kError, decoder.Feed(data, sizeof(data)));
+}
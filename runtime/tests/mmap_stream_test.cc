@@ -0,0 +1,88 @@
+#include "decaproto/stream/mmap_stream.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+
+#include "decaproto/decoder.h"
+#include "decaproto/stream/coded_stream.h"
+#include "decaproto/stream/string_stream.h"
+#include "fake_message.h"
+
+using namespace decaproto;
+using namespace std;
+
+namespace {
+
+string WriteTempFile(const string& content) {
+    string path = testing::TempDir() + "mmap_stream_test.bin";
+    ofstream ofs(path, ios::binary | ios::trunc);
+    ofs << content;
+    return path;
+}
+
+}  // namespace
+
+TEST(MmapStreamTest, ReadTest) {
+    string path = WriteTempFile(string("\x96\x01test", 6));
+
+    MmapInputStream ins;
+    EXPECT_TRUE(ins.Open(path));
+    EXPECT_EQ(6, ins.Size());
+    {
+        CodedInputStream cis(&ins);
+        uint32_t varint;
+        EXPECT_TRUE(cis.ReadVarint32(varint));
+        EXPECT_EQ(150, varint);
+    }
+    EXPECT_EQ(2, ins.Position());
+
+    CodedInputStream cis(&ins);
+    string str;
+    EXPECT_TRUE(cis.ReadString(str, 4));
+    EXPECT_EQ("test", str);
+    EXPECT_FALSE(cis.ReadString(str, 1));
+
+    remove(path.c_str());
+}
+
+TEST(MmapStreamTest, DecodeTest) {
+    FakeMessage src;
+    src.set_num(10);
+    src.set_str("test");
+    src.mutable_other()->set_num(150);
+    string encoded;
+    StringOutputStream outs(&encoded);
+    size_t written_size;
+    EXPECT_TRUE(src.Encode(outs, written_size));
+    string path = WriteTempFile(encoded);
+
+    MmapInputStream ins;
+    EXPECT_TRUE(ins.Open(path));
+    FakeMessage m;
+    EXPECT_TRUE(DecodeMessage(ins, &m));
+    EXPECT_EQ(10, m.num());
+    EXPECT_EQ("test", m.str());
+    EXPECT_EQ(150, m.other().num());
+    EXPECT_EQ(encoded.size(), ins.Position());
+
+    remove(path.c_str());
+}
+
+TEST(MmapStreamTest, EmptyFileTest) {
+    string path = WriteTempFile("");
+
+    MmapInputStream ins;
+    EXPECT_TRUE(ins.Open(path));
+    EXPECT_EQ(0, ins.Size());
+    uint8_t b;
+    EXPECT_FALSE(ins.Read(b));
+
+    remove(path.c_str());
+}
+
+TEST(MmapStreamTest, MissingFileTest) {
+    MmapInputStream ins;
+    EXPECT_FALSE(ins.Open(testing::TempDir() + "no_such_file.bin"));
+}
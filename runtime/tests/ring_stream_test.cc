@@ -0,0 +1,103 @@
+#include "decaproto/stream/ring_stream.h"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include "decaproto/delimited.h"
+#include "decaproto/stream/coded_stream.h"
+#include "fake_message.h"
+
+using namespace decaproto;
+using namespace std;
+
+TEST(RingStreamTest, RingBufferTest) {
+    SpscRingBuffer ring(6);
+    EXPECT_EQ(8, ring.Capacity());
+
+    uint8_t* wdata;
+    EXPECT_EQ(8, ring.WritableRegion(wdata));
+    wdata[0] = 'a';
+    wdata[1] = 'b';
+    wdata[2] = 'c';
+    ring.Commit(3);
+
+    const uint8_t* rdata;
+    EXPECT_EQ(3, ring.ReadableRegion(rdata));
+    EXPECT_EQ('a', rdata[0]);
+    ring.Consume(2);
+
+    // The free region wraps around the end of the buffer
+    EXPECT_EQ(5, ring.WritableRegion(wdata));
+    ring.Commit(5);
+    EXPECT_EQ(2, ring.WritableRegion(wdata));
+    ring.Commit(2);
+    EXPECT_EQ(0, ring.WritableRegion(wdata));
+
+    EXPECT_EQ(6, ring.ReadableRegion(rdata));
+    EXPECT_EQ('c', rdata[0]);
+    ring.Consume(6);
+    EXPECT_EQ(2, ring.ReadableRegion(rdata));
+    ring.Consume(2);
+
+    EXPECT_FALSE(ring.IsDrained());
+    ring.Close();
+    EXPECT_TRUE(ring.IsDrained());
+}
+
+TEST(RingStreamTest, BackUpTest) {
+    SpscRingBuffer ring(16);
+    RingOutputStream outs(&ring);
+    RingInputStream ins(&ring);
+    {
+        CodedOutputStream cos(&outs);
+        EXPECT_TRUE(cos.WriteVarint32(150));
+    }
+    // Published when CodedOutputStream backs up the rest of the region
+    EXPECT_EQ(2, outs.ByteCount());
+    {
+        CodedInputStream cis(&ins);
+        uint32_t value;
+        EXPECT_TRUE(cis.ReadVarint32(value));
+        EXPECT_EQ(150, value);
+    }
+    EXPECT_EQ(2, ins.ByteCount());
+
+    outs.Close();
+    const void* data;
+    int size;
+    EXPECT_FALSE(ins.Next(&data, &size));
+}
+
+TEST(RingStreamTest, TwoThreadsTest) {
+    const int kCount = 10000;
+    // Much smaller than the data so that both threads wait for each other
+    // and values wrap around the end of the ring.
+    SpscRingBuffer ring(64);
+
+    thread producer([&ring] {
+        RingOutputStream outs(&ring);
+        for (int i = 0; i < kCount; i++) {
+            FakeMessage msg;
+            msg.set_num(i);
+            msg.set_str("message " + to_string(i));
+            CodedOutputStream cos(&outs);
+            EXPECT_TRUE(EncodeDelimited(msg, cos));
+        }
+        // RingOutputStream closes the ring on destruction
+    });
+
+    RingInputStream ins(&ring);
+    DelimitedReader reader(&ins);
+    FakeMessage msg;
+    int count = 0;
+    while (reader.Next(&msg)) {
+        EXPECT_EQ(count, msg.num());
+        EXPECT_EQ("message " + to_string(count), msg.str());
+        count++;
+    }
+    producer.join();
+
+    EXPECT_FALSE(reader.HadError());
+    EXPECT_EQ(kCount, count);
+}
@@ -0,0 +1,87 @@
+#include "decaproto/stream/stl.h"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+#include "decaproto/stream/coded_stream.h"
+
+using namespace decaproto;
+using namespace std;
+
+TEST(StlStreamTest, BufferedReadTest) {
+    stringstream ss;
+    ss << "\x96\x01"
+       << "hello world"
+       << "\x05";
+    {
+        BufferedStlInputStream ins(&ss, 4);
+        CodedInputStream cis(&ins);
+
+        uint32_t varint;
+        EXPECT_TRUE(cis.ReadVarint32(varint));
+        EXPECT_EQ(150, varint);
+
+        // Spans several blocks
+        string str;
+        EXPECT_TRUE(cis.ReadString(str, 11));
+        EXPECT_EQ("hello world", str);
+    }
+    // Buffered but unread bytes are returned to the istream
+    EXPECT_EQ(5, ss.get());
+}
+
+TEST(StlStreamTest, BufferedLargeReadTest) {
+    string data(100, 'x');
+    stringstream ss(data);
+    BufferedStlInputStream ins(&ss, 8);
+
+    uint8_t b;
+    EXPECT_TRUE(ins.Read(b));
+    uint8_t buf[99];
+    EXPECT_TRUE(ins.ReadBytes(buf, sizeof(buf)));
+    EXPECT_EQ(99, ins.LastReadSize());
+    EXPECT_EQ('x', buf[98]);
+    EXPECT_FALSE(ins.Read(b));
+}
+
+TEST(StlStreamTest, BufferedShortReadTest) {
+    stringstream ss("abcde");
+    BufferedStlInputStream ins(&ss, 2);
+
+    uint8_t buf[8];
+    EXPECT_FALSE(ins.ReadBytes(buf, sizeof(buf)));
+    EXPECT_EQ(5, ins.LastReadSize());
+    EXPECT_EQ('e', buf[4]);
+    EXPECT_TRUE(ss.eof());
+}
+
+TEST(StlStreamTest, BufferedWriteTest) {
+    stringstream ss;
+    {
+        BufferedStlOutputStream outs(&ss, 4);
+        CodedOutputStream cos(&outs);
+        EXPECT_TRUE(cos.WriteVarint32(150));
+        EXPECT_TRUE(cos.WriteString("hello world"));
+        EXPECT_TRUE(cos.WriteFixedInt32(0x04030201));
+        EXPECT_EQ(17, cos.WrittenSize());
+    }
+    // Flushed on destruction
+    EXPECT_EQ(string("\x96\x01hello world\x01\x02\x03\x04", 17), ss.str());
+}
+
+TEST(StlStreamTest, BufferedFlushTest) {
+    stringstream ss;
+    BufferedStlOutputStream outs(&ss, 16);
+    EXPECT_TRUE(outs.Write('a'));
+    EXPECT_EQ("", ss.str());
+
+    EXPECT_TRUE(outs.Flush());
+    EXPECT_EQ("a", ss.str());
+
+    // Larger than the buffer
+    string large(32, 'b');
+    EXPECT_TRUE(outs.WriteBytes(
+            reinterpret_cast<const uint8_t*>(large.data()), large.size()));
+    EXPECT_EQ("a" + large, ss.str());
+}
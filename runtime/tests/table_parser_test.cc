@@ -0,0 +1,196 @@
+#include "decaproto/table_parser.h"
+
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "decaproto/stream/coded_stream.h"
+#include "decaproto/stream/string_stream.h"
+
+using namespace decaproto;
+using namespace std;
+
+namespace {
+
+// ParseWithTable() only needs the layout of fields, so plain structs stand in
+// for generated messages here.
+
+enum Color : int {
+    RED = 0,
+    GREEN = 1,
+};
+
+struct Point {
+    int32_t x;
+    float y;
+};
+
+const TableField kPointFields[] = {
+        {1, kVarint, kInt32, false, offsetof(Point, x), 0, nullptr, nullptr},
+        {2, kI32, kFloat, false, offsetof(Point, y), 0, nullptr, nullptr},
+};
+
+const ParseTable kPointTable = {kPointFields, 2};
+
+struct Shape {
+    uint32_t id = 0;
+    string name;
+    string_view name_view;
+    vector<int64_t> values;
+    vector<Color> colors;
+    vector<Point> points;
+
+    static void* AddColor(void* message) {
+        Shape* shape = static_cast<Shape*>(message);
+        shape->colors.push_back(RED);
+        return &shape->colors.back();
+    }
+
+    static void* AddPoint(void* message) {
+        Shape* shape = static_cast<Shape*>(message);
+        shape->points.emplace_back();
+        return &shape->points.back();
+    }
+};
+
+const TableField kShapeFields[] = {
+        {1, kVarint, kUint32, false, offsetof(Shape, id), 0, nullptr, nullptr},
+        {2,
+         kLen,
+         kString,
+         false,
+         offsetof(Shape, name),
+         offsetof(Shape, name_view),
+         nullptr,
+         nullptr},
+        {3, kVarint, kSint64, true, offsetof(Shape, values), 0, nullptr, nullptr},
+        {4, kVarint, kEnum, true, 0, 0, &Shape::AddColor, nullptr},
+        {1000, kLen, kMessage, true, 0, 0, &Shape::AddPoint, &kPointTable},
+};
+
+const ParseTable kShapeTable = {kShapeFields, 5};
+
+string EncodeShape() {
+    string data;
+    StringOutputStream out(&data);
+    CodedOutputStream cos(&out);
+    // id: 150
+    cos.WriteVarint32(1 << 3 | kVarint);
+    cos.WriteVarint32(150);
+    // point { x: -3, y: 1.5 }
+    string point;
+    {
+        StringOutputStream sub_out(&point);
+        CodedOutputStream sub(&sub_out);
+        sub.WriteVarint32(1 << 3 | kVarint);
+        sub.WriteVarint64(static_cast<uint64_t>(-3));
+        sub.WriteVarint32(2 << 3 | kI32);
+        sub.WriteFixedInt32(0x3fc00000);
+    }
+    cos.WriteVarint32(1000 << 3 | kLen);
+    cos.WriteVarint32(point.size());
+    cos.WriteString(point);
+    // values: -1, 2 (out of order)
+    cos.WriteVarint32(3 << 3 | kVarint);
+    cos.WriteSignedVarint64(-1);
+    cos.WriteVarint32(3 << 3 | kVarint);
+    cos.WriteSignedVarint64(2);
+    // Unknown field 7
+    cos.WriteVarint32(7 << 3 | kVarint);
+    cos.WriteVarint32(42);
+    // name: "shape"
+    cos.WriteVarint32(2 << 3 | kLen);
+    cos.WriteVarint32(5);
+    cos.WriteString("shape");
+    // colors: GREEN, RED
+    cos.WriteVarint32(4 << 3 | kVarint);
+    cos.WriteVarint32(GREEN);
+    cos.WriteVarint32(4 << 3 | kVarint);
+    cos.WriteVarint32(RED);
+    return data;
+}
+
+}  // namespace
+
+TEST(TableParserTest, ParseTest) {
+    string data = EncodeShape();
+    CodedInputStream cis(
+            reinterpret_cast<const uint8_t*>(data.data()), data.size());
+
+    Shape shape;
+    EXPECT_TRUE(ParseWithTable(cis, kShapeTable, &shape));
+    EXPECT_EQ(150, shape.id);
+    EXPECT_EQ("shape", shape.name);
+    EXPECT_EQ(nullptr, shape.name_view.data());
+    EXPECT_EQ(vector<int64_t>({-1, 2}), shape.values);
+    EXPECT_EQ(vector<Color>({GREEN, RED}), shape.colors);
+    ASSERT_EQ(1, shape.points.size());
+    EXPECT_EQ(-3, shape.points[0].x);
+    EXPECT_EQ(1.5f, shape.points[0].y);
+}
+
+TEST(TableParserTest, AliasingTest) {
+    string data = EncodeShape();
+    CodedInputStream cis(
+            reinterpret_cast<const uint8_t*>(data.data()), data.size());
+    cis.EnableAliasing(true);
+
+    Shape shape;
+    EXPECT_TRUE(ParseWithTable(cis, kShapeTable, &shape));
+    EXPECT_EQ("", shape.name);
+    EXPECT_EQ("shape", shape.name_view);
+    EXPECT_GE(shape.name_view.data(), data.data());
+    EXPECT_LT(shape.name_view.data(), data.data() + data.size());
+}
+
+TEST(TableParserTest, WrongWireTypeTest) {
+    // id as fixed32
+    string data = "\x0d\x01\x02\x03\x04";
+    CodedInputStream cis(
+            reinterpret_cast<const uint8_t*>(data.data()), data.size());
+
+    Shape shape;
+    EXPECT_FALSE(ParseWithTable(cis, kShapeTable, &shape));
+}
+
+TEST(TableParserTest, TruncatedTest) {
+    string data = EncodeShape();
+    // Drop the value of the last field
+    data.pop_back();
+    CodedInputStream cis(
+            reinterpret_cast<const uint8_t*>(data.data()), data.size());
+
+    Shape shape;
+    EXPECT_FALSE(ParseWithTable(cis, kShapeTable, &shape));
+}
+
+TEST(TableParserTest, PackedTest) {
+    string data;
+    {
+        StringOutputStream out(&data);
+        CodedOutputStream cos(&out);
+        // values: LEN 2 {-1, 2}
+        cos.WriteVarint32(3 << 3 | kLen);
+        cos.WriteVarint32(2);
+        cos.WriteSignedVarint64(-1);
+        cos.WriteSignedVarint64(2);
+        // values: 3 (unpacked elements of the same field are accepted too)
+        cos.WriteVarint32(3 << 3 | kVarint);
+        cos.WriteSignedVarint64(3);
+        // colors: LEN 2 {GREEN, RED}
+        cos.WriteVarint32(4 << 3 | kLen);
+        cos.WriteVarint32(2);
+        cos.WriteVarint32(GREEN);
+        cos.WriteVarint32(RED);
+    }
+    CodedInputStream cis(
+            reinterpret_cast<const uint8_t*>(data.data()), data.size());
+
+    Shape shape;
+    EXPECT_TRUE(ParseWithTable(cis, kShapeTable, &shape));
+    EXPECT_EQ(vector<int64_t>({-1, 2, 3}), shape.values);
+    EXPECT_EQ(vector<Color>({GREEN, RED}), shape.colors);
+}
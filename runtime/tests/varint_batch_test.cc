@@ -0,0 +1,249 @@
+#include "decaproto/stream/varint_batch.h"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+#include "decaproto/stream/coded_stream.h"
+#include "decaproto/stream/stl.h"
+#include "decaproto/stream/string_stream.h"
+
+using namespace decaproto;
+using namespace std;
+
+namespace {
+
+string EncodeVarints(const vector<uint64_t>& values) {
+    string data;
+    {
+        StringOutputStream out(&data);
+        CodedOutputStream cos(&out);
+        for (uint64_t value : values) {
+            cos.WriteVarint64(value);
+        }
+    }
+    return data;
+}
+
+// Mostly one-byte values with some longer ones, so that both the vector path
+// and the masked path are taken.
+vector<uint64_t> MixedValues(size_t count) {
+    vector<uint64_t> values;
+    for (size_t i = 0; i < count; i++) {
+        if (i % 37 == 5) {
+            values.push_back(300 + i);
+        } else if (i % 101 == 7) {
+            values.push_back(UINT64_MAX - i);
+        } else {
+            values.push_back(i % 128);
+        }
+    }
+    return values;
+}
+
+const VarintBatchKernel kKernels[] = {
+        kVarintBatchScalar,
+        kVarintBatchSse41,
+        kVarintBatchAvx2,
+};
+
+}  // namespace
+
+class VarintBatchTest : public testing::TestWithParam<VarintBatchKernel> {
+protected:
+    void SetUp() override {
+        if (GetParam() > GetVarintBatchKernel()) {
+            GTEST_SKIP() << "Not supported by this CPU";
+        }
+        SetVarintBatchKernel(GetParam());
+    }
+
+    void TearDown() override {
+        SetVarintBatchKernel(GetVarintBatchKernel());
+    }
+};
+
+TEST_P(VarintBatchTest, Uint64Test) {
+    // Try various lengths to cover both the blocks and the tail.
+    for (size_t count : {0, 1, 15, 16, 17, 31, 32, 33, 100, 1000}) {
+        vector<uint64_t> values = MixedValues(count);
+        string data = EncodeVarints(values);
+
+        vector<uint64_t> result;
+        EXPECT_TRUE(DecodeVarintBatch(
+                reinterpret_cast<const uint8_t*>(data.data()),
+                data.size(),
+                result));
+        EXPECT_EQ(values, result);
+    }
+}
+
+TEST_P(VarintBatchTest, Uint32Test) {
+    vector<uint64_t> values = MixedValues(1000);
+    string data = EncodeVarints(values);
+
+    vector<uint32_t> result;
+    EXPECT_TRUE(DecodeVarintBatch(
+            reinterpret_cast<const uint8_t*>(data.data()),
+            data.size(),
+            result));
+    ASSERT_EQ(values.size(), result.size());
+    for (size_t i = 0; i < values.size(); i++) {
+        // Truncated like int32 values
+        EXPECT_EQ(static_cast<uint32_t>(values[i]), result[i]);
+    }
+}
+
+TEST_P(VarintBatchTest, AllOneByteTest) {
+    vector<uint64_t> values;
+    for (size_t i = 0; i < 100; i++) {
+        values.push_back(i);
+    }
+    string data = EncodeVarints(values);
+
+    vector<uint32_t> result;
+    EXPECT_TRUE(DecodeVarintBatch(
+            reinterpret_cast<const uint8_t*>(data.data()),
+            data.size(),
+            result));
+    EXPECT_EQ(vector<uint32_t>(values.begin(), values.end()), result);
+}
+
+TEST_P(VarintBatchTest, ZigZagTest) {
+    vector<int32_t> values32;
+    vector<int64_t> values64;
+    vector<uint64_t> encoded32;
+    vector<uint64_t> encoded64;
+    for (int i = 0; i < 100; i++) {
+        int32_t v = (i % 2 == 0 ? i : -i) * (i % 10 == 3 ? 100000 : 1);
+        values32.push_back(v);
+        int64_t scale = i % 7 == 1 ? 1000000 : 1;
+        values64.push_back(static_cast<int64_t>(v) * scale);
+        encoded32.push_back(
+                CodedOutputStream::EncodeZigZag32(values32.back()));
+        encoded64.push_back(CodedOutputStream::EncodeZigZag(values64.back()));
+    }
+    values32.push_back(INT32_MIN);
+    encoded32.push_back(CodedOutputStream::EncodeZigZag32(INT32_MIN));
+    values64.push_back(INT64_MIN);
+    encoded64.push_back(CodedOutputStream::EncodeZigZag(INT64_MIN));
+
+    string data32 = EncodeVarints(encoded32);
+    vector<uint32_t> result32;
+    EXPECT_TRUE(DecodeVarintBatch(
+            reinterpret_cast<const uint8_t*>(data32.data()),
+            data32.size(),
+            result32,
+            true));
+    ASSERT_EQ(values32.size(), result32.size());
+    for (size_t i = 0; i < values32.size(); i++) {
+        EXPECT_EQ(values32[i], static_cast<int32_t>(result32[i]));
+    }
+
+    string data64 = EncodeVarints(encoded64);
+    vector<uint64_t> result64;
+    EXPECT_TRUE(DecodeVarintBatch(
+            reinterpret_cast<const uint8_t*>(data64.data()),
+            data64.size(),
+            result64,
+            true));
+    ASSERT_EQ(values64.size(), result64.size());
+    for (size_t i = 0; i < values64.size(); i++) {
+        EXPECT_EQ(values64[i], static_cast<int64_t>(result64[i]));
+    }
+}
+
+TEST_P(VarintBatchTest, AppendTest) {
+    string data = EncodeVarints({1, 2, 300});
+
+    vector<uint32_t> result = {100};
+    EXPECT_TRUE(DecodeVarintBatch(
+            reinterpret_cast<const uint8_t*>(data.data()),
+            data.size(),
+            result));
+    EXPECT_EQ(vector<uint32_t>({100, 1, 2, 300}), result);
+}
+
+TEST_P(VarintBatchTest, TruncatedTest) {
+    vector<uint64_t> values = MixedValues(100);
+    values.push_back(300);
+    string data = EncodeVarints(values);
+    // Drop the last byte of 300
+    data.pop_back();
+
+    vector<uint64_t> result;
+    EXPECT_FALSE(DecodeVarintBatch(
+            reinterpret_cast<const uint8_t*>(data.data()),
+            data.size(),
+            result));
+    // The values before the broken one are kept.
+    values.pop_back();
+    EXPECT_EQ(values, result);
+}
+
+TEST_P(VarintBatchTest, TooLongTest) {
+    string data(100, '\x01');
+    // 11-byte varint in the middle of the data
+    for (int i = 40; i < 50; i++) {
+        data[i] = '\x80';
+    }
+
+    vector<uint64_t> result;
+    EXPECT_FALSE(DecodeVarintBatch(
+            reinterpret_cast<const uint8_t*>(data.data()),
+            data.size(),
+            result));
+}
+
+INSTANTIATE_TEST_SUITE_P(
+        Kernels, VarintBatchTest, testing::ValuesIn(kKernels));
+
+TEST(ReadVarintArrayTest, ReadTest) {
+    vector<uint64_t> values = MixedValues(100);
+    // Followed by another value
+    string data = EncodeVarints(values) + "\x2a";
+    size_t len = data.size() - 1;
+
+    {
+        // In place
+        CodedInputStream cis(
+                reinterpret_cast<const uint8_t*>(data.data()), data.size());
+        vector<uint64_t> result;
+        EXPECT_TRUE(cis.ReadVarintArray(result, len));
+        EXPECT_EQ(values, result);
+        uint32_t next;
+        EXPECT_TRUE(cis.ReadVarint32(next));
+        EXPECT_EQ(42, next);
+    }
+    {
+        // Across chunks
+        StringZeroCopyInputStream ins(&data, 7);
+        CodedInputStream cis(&ins);
+        vector<uint64_t> result;
+        EXPECT_TRUE(cis.ReadVarintArray(result, len));
+        EXPECT_EQ(values, result);
+        uint32_t next;
+        EXPECT_TRUE(cis.ReadVarint32(next));
+        EXPECT_EQ(42, next);
+    }
+    {
+        // Through InputStream
+        stringstream ss(data);
+        StlInputStream in(&ss);
+        CodedInputStream cis(&in);
+        vector<uint64_t> result;
+        EXPECT_TRUE(cis.ReadVarintArray(result, len));
+        EXPECT_EQ(values, result);
+        uint32_t next;
+        EXPECT_TRUE(cis.ReadVarint32(next));
+        EXPECT_EQ(42, next);
+    }
+}
+
+TEST(ReadVarintArrayTest, EndOfStreamTest) {
+    string data = EncodeVarints({1, 2, 3});
+    CodedInputStream cis(
+            reinterpret_cast<const uint8_t*>(data.data()), data.size());
+    vector<uint32_t> result;
+    EXPECT_FALSE(cis.ReadVarintArray(result, data.size() + 1));
+}
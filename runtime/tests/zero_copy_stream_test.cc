@@ -0,0 +1,159 @@
+#include "decaproto/stream/zero_copy_stream.h"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+#include "decaproto/decoder.h"
+#include "decaproto/stream/coded_stream.h"
+#include "decaproto/stream/stl.h"
+#include "fake_message.h"
+
+using namespace decaproto;
+using namespace std;
+
+TEST(ZeroCopyStreamTest, StringInputStreamTest) {
+    string data = "abcde";
+    StringZeroCopyInputStream ins(&data, 2);
+
+    const void* chunk = nullptr;
+    int size = 0;
+    EXPECT_TRUE(ins.Next(&chunk, &size));
+    EXPECT_EQ(2, size);
+    EXPECT_EQ('a', *static_cast<const char*>(chunk));
+
+    ins.BackUp(1);
+    EXPECT_EQ(1, ins.ByteCount());
+
+    EXPECT_TRUE(ins.Next(&chunk, &size));
+    EXPECT_EQ(2, size);
+    EXPECT_EQ('b', *static_cast<const char*>(chunk));
+    EXPECT_TRUE(ins.Next(&chunk, &size));
+    EXPECT_EQ(2, size);
+    EXPECT_EQ('d', *static_cast<const char*>(chunk));
+    EXPECT_EQ(5, ins.ByteCount());
+
+    EXPECT_FALSE(ins.Next(&chunk, &size));
+}
+
+TEST(ZeroCopyStreamTest, CodedInputStreamAcrossChunksTest) {
+    // varint 150, fixed32 0x04030201, "hello"
+    string data = "\x96\x01\x01\x02\x03\x04hello";
+    // Every value spans two or more chunks
+    StringZeroCopyInputStream ins(&data, 1);
+    CodedInputStream cis(&ins);
+
+    uint32_t varint;
+    EXPECT_TRUE(cis.ReadVarint32(varint));
+    EXPECT_EQ(150, varint);
+
+    uint32_t fixed;
+    EXPECT_TRUE(cis.ReadFixedInt32(fixed));
+    EXPECT_EQ(0x04030201, fixed);
+
+    string str;
+    EXPECT_TRUE(cis.ReadString(str, 5));
+    EXPECT_EQ("hello", str);
+    EXPECT_EQ(data.size(), cis.ConsumedSize());
+
+    EXPECT_FALSE(cis.ReadVarint32(varint));
+}
+
+TEST(ZeroCopyStreamTest, BackUpOnDestructionTest) {
+    string data = "\x01\x02\x03\x04";
+    StringZeroCopyInputStream ins(&data);
+    {
+        CodedInputStream cis(&ins);
+        uint32_t value;
+        EXPECT_TRUE(cis.ReadVarint32(value));
+        EXPECT_EQ(1, value);
+    }
+    // Unread bytes must be returned to the stream
+    EXPECT_EQ(1, ins.ByteCount());
+
+    CodedInputStream cis(&ins);
+    uint32_t value;
+    EXPECT_TRUE(cis.ReadVarint32(value));
+    EXPECT_EQ(2, value);
+}
+
+TEST(ZeroCopyStreamTest, BlockListInputStreamTest) {
+    const uint8_t block0[] = {0x96, 0x01, 'a'};
+    const uint8_t block1[] = {'b', 'c', 0x08};
+    const uint8_t block2[] = {0x01};
+    const uint8_t* blocks[] = {block0, block1, block2};
+    BlockListInputStream ins(blocks, 3, 3, 1);
+    CodedInputStream cis(&ins);
+
+    uint32_t varint;
+    EXPECT_TRUE(cis.ReadVarint32(varint));
+    EXPECT_EQ(150, varint);
+
+    string str;
+    EXPECT_TRUE(cis.ReadString(str, 3));
+    EXPECT_EQ("abc", str);
+
+    cis.Skip(1);
+    EXPECT_TRUE(cis.ReadVarint32(varint));
+    EXPECT_EQ(1, varint);
+    EXPECT_EQ(7, cis.ConsumedSize());
+
+    EXPECT_FALSE(cis.ReadString(str, 1));
+}
+
+TEST(ZeroCopyStreamTest, StlInputStreamTest) {
+    stringstream ss;
+    ss << "\x96\x01"
+       << "abc"
+       << "\x05";
+    {
+        StlZeroCopyInputStream ins(&ss, 2);
+        CodedInputStream cis(&ins);
+
+        uint32_t varint;
+        EXPECT_TRUE(cis.ReadVarint32(varint));
+        EXPECT_EQ(150, varint);
+
+        string str;
+        EXPECT_TRUE(cis.ReadString(str, 3));
+        EXPECT_EQ("abc", str);
+    }
+    // The last byte has been backed up and returned to the istream
+    EXPECT_EQ(5, ss.get());
+}
+
+TEST(ZeroCopyStreamTest, StringOutputStreamTest) {
+    string out = "prefix";
+    {
+        StringZeroCopyOutputStream outs(&out);
+        CodedOutputStream cos(&outs);
+        EXPECT_TRUE(cos.WriteVarint32(150));
+        EXPECT_TRUE(cos.WriteString(string(100, 'x')));
+        EXPECT_TRUE(cos.WriteFixedInt32(0x04030201));
+        EXPECT_EQ(106, cos.WrittenSize());
+    }
+    // The unused part of the last chunk must be trimmed
+    EXPECT_EQ(
+            "prefix\x96\x01" + string(100, 'x') + "\x01\x02\x03\x04", out);
+}
+
+TEST(ZeroCopyStreamTest, EncodeDecodeTest) {
+    FakeMessage src;
+    src.set_num(10);
+    src.set_str("test");
+    src.mutable_other()->set_num(150);
+
+    string encoded;
+    StringZeroCopyOutputStream outs(&encoded);
+    size_t written_size;
+    EXPECT_TRUE(src.Encode(outs, written_size));
+    EXPECT_EQ(src.ComputeEncodedSize(), written_size);
+    EXPECT_EQ(written_size, encoded.size());
+
+    StringZeroCopyInputStream ins(&encoded, 3);
+    FakeMessage m;
+    EXPECT_TRUE(DecodeMessage(ins, &m));
+    EXPECT_EQ(10, m.num());
+    EXPECT_EQ("test", m.str());
+    EXPECT_EQ(150, m.other().num());
+}
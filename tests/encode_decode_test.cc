@@ -3,8 +3,12 @@
 #include <sstream>
 
 #include "decaproto/decoder.h"
+#include "decaproto/delimited.h"
 #include "decaproto/encoder.h"
+#include "decaproto/stream/coded_stream.h"
 #include "decaproto/stream/stl.h"
+#include "decaproto/stream/string_stream.h"
+#include "decaproto/table_parser.h"
 #include "tests/nested.pb.h"
 #include "tests/numeric_types.pb.h"
 #include "tests/repeated.pb.h"
@@ -47,6 +51,63 @@ TEST(EncodeDecodeTest, SimpleMessageTest) {
     EXPECT_EQ(src.bool_value(), dst.bool_value());
 }
 
+TEST(EncodeDecodeTest, AliasingTest) {
+    SimpleMessage src;
+    src.set_num(1234567890);
+    src.set_str("Udong");
+    src.mutable_other()->set_other_num(987654321);
+
+    string encoded;
+    StringOutputStream oss(&encoded);
+    size_t size;
+    EXPECT_TRUE(src.Encode(oss, size));
+
+    SimpleMessage dst;
+    EXPECT_TRUE(DecodeMessageAliasing(
+            reinterpret_cast<const uint8_t*>(encoded.data()),
+            encoded.size(),
+            &dst));
+    EXPECT_EQ(src.num(), dst.num());
+    EXPECT_EQ(src.other().other_num(), dst.other().other_num());
+    // The string refers to the encoded bytes.
+    EXPECT_EQ("Udong", dst.str_view());
+    EXPECT_GE(dst.str_view().data(), encoded.data());
+    EXPECT_LT(dst.str_view().data(), encoded.data() + encoded.size());
+
+    string reencoded;
+    StringOutputStream reoss(&reencoded);
+    EXPECT_TRUE(dst.Encode(reoss, size));
+    EXPECT_EQ(encoded, reencoded);
+}
+
+TEST(EncodeDecodeTest, LargeFieldNumbersTest) {
+    LargeFieldNumbers src;
+    src.set_small(1);
+    src.set_medium(2);
+    src.set_large("large");
+    *src.add_fixed() = 3;
+    *src.add_fixed() = 4;
+    src.mutable_other()->set_other_num(5);
+
+    string encoded;
+    StringOutputStream oss(&encoded);
+    size_t size;
+    EXPECT_TRUE(src.Encode(oss, size));
+    // Tags of fields >= 16 take more than 1 byte.
+    EXPECT_EQ(src.ComputeEncodedSize(), size);
+    EXPECT_EQ(size, encoded.size());
+
+    stringstream ss(encoded);
+    StlInputStream iss(&ss);
+    LargeFieldNumbers dst;
+    EXPECT_TRUE(DecodeMessage(iss, &dst));
+    EXPECT_EQ(1, dst.small());
+    EXPECT_EQ(2, dst.medium());
+    EXPECT_EQ("large", dst.large());
+    EXPECT_EQ(src.fixed(), dst.fixed());
+    EXPECT_EQ(5, dst.other().other_num());
+}
+
 template <typename T>
 void testRepeatedField(const T& src, const T& dst) {
     EXPECT_EQ(src.size(), dst.size());
@@ -155,6 +216,96 @@ TEST(EncodeDecodeTest, NumericTypesTest) {
     EXPECT_NEAR(src.double_value(), dst.double_value(), EPSILON);
 }
 
+TEST(EncodeDecodeTest, GeneratedDecoderTest) {
+    NumericTypes src;
+    src.set_int32_value(-123);
+    src.set_sint64_value(-1234567890);
+    src.set_double_value(2.71828);
+    string encoded;
+    {
+        StringOutputStream out(&encoded);
+        CodedOutputStream cos(&out);
+        EXPECT_TRUE(src.EncodeImpl(cos));
+        // Unknown field 100 (varint: 7)
+        cos.WriteVarint32(100 << 3 | 0);
+        cos.WriteVarint32(7);
+    }
+
+    // The generated decoder and the reflection-based one agree.
+    NumericTypes generated;
+    CodedInputStream cis(
+            reinterpret_cast<const uint8_t*>(encoded.data()), encoded.size());
+    EXPECT_TRUE(DecodeMessage(cis, encoded.size(), &generated));
+
+    NumericTypes reflected;
+    CodedInputStream cis2(
+            reinterpret_cast<const uint8_t*>(encoded.data()), encoded.size());
+    EXPECT_TRUE(DecodeMessage(
+            cis2,
+            encoded.size(),
+            &reflected,
+            reflected.GetReflection(),
+            reflected.GetDescriptor()));
+
+    EXPECT_EQ(-123, generated.int32_value());
+    EXPECT_EQ(-1234567890, generated.sint64_value());
+    EXPECT_NEAR(2.71828, generated.double_value(), EPSILON);
+    EXPECT_EQ(reflected.int32_value(), generated.int32_value());
+    EXPECT_EQ(reflected.sint64_value(), generated.sint64_value());
+    EXPECT_EQ(reflected.double_value(), generated.double_value());
+}
+
+TEST(EncodeDecodeTest, GeneratedDecoderWrongWireTypeTest) {
+    // int32_value = 3 as fixed32
+    string encoded = "\x1d\x01\x02\x03\x04";
+    NumericTypes dst;
+    CodedInputStream cis(
+            reinterpret_cast<const uint8_t*>(encoded.data()), encoded.size());
+    EXPECT_FALSE(DecodeMessage(cis, encoded.size(), &dst));
+}
+
+TEST(EncodeDecodeTest, TableParserTest) {
+    RepeatedRepeatedMessage src;
+    RepeatedMessage* rep = src.add_repeated_messages();
+    rep->mutable_nums()->push_back(10);
+    rep->mutable_strs()->push_back("Udong");
+    rep->mutable_enum_values()->push_back(REP_ENUM_B);
+    SimpleMessage* simple = rep->add_simple_messages();
+    simple->set_str("foo");
+    simple->set_enum_value(ENUM_C);
+    simple->mutable_other()->set_other_num(100);
+    simple->set_double_value(2.71828);
+    simple->set_bool_value(true);
+    src.add_repeated_messages();
+    string encoded;
+    {
+        StringOutputStream out(&encoded);
+        CodedOutputStream cos(&out);
+        EXPECT_TRUE(src.EncodeImpl(cos));
+    }
+
+    // Decode with the table regardless of the decoder option.
+    RepeatedRepeatedMessage dst;
+    CodedInputStream cis(
+            reinterpret_cast<const uint8_t*>(encoded.data()), encoded.size());
+    EXPECT_TRUE(ParseWithTable(cis, RepeatedRepeatedMessage::kParseTable, &dst));
+
+    ASSERT_EQ(2, dst.repeated_messages().size());
+    const RepeatedMessage& dst_rep = dst.repeated_messages()[0];
+    EXPECT_EQ(vector<int32_t>({10}), dst_rep.nums());
+    EXPECT_EQ(vector<string>({"Udong"}), dst_rep.strs());
+    EXPECT_EQ(vector<RepeatedEnum>({REP_ENUM_B}), dst_rep.enum_values());
+    ASSERT_EQ(1, dst_rep.simple_messages().size());
+    const SimpleMessage& dst_simple = dst_rep.simple_messages()[0];
+    EXPECT_EQ("foo", dst_simple.str());
+    EXPECT_EQ(ENUM_C, dst_simple.enum_value());
+    EXPECT_TRUE(dst_simple.has_other());
+    EXPECT_EQ(100, dst_simple.other().other_num());
+    EXPECT_EQ(2.71828, dst_simple.double_value());
+    EXPECT_TRUE(dst_simple.bool_value());
+    EXPECT_EQ(0, dst.repeated_messages()[1].nums().size());
+}
+
 TEST(EncodeDecodeTest, RepeatedNumericTypesTest) {
     stringstream ss;
     StlInputStream iss(&ss);
@@ -235,6 +386,141 @@ TEST(EncodeDecodeTest, RepeatedNumericTypesTest) {
     testRepeatedField(src.double_values(), dst.double_values());
 }
 
+TEST(EncodeDecodeTest, PackedRepeatedFieldsTest) {
+    string encoded;
+    {
+        StringOutputStream out(&encoded);
+        CodedOutputStream cos(&out);
+        // int32_values: LEN {1, -1} (-1 takes 10 bytes)
+        cos.WriteVarint32(3 << 3 | kLen);
+        cos.WriteVarint32(11);
+        cos.WriteVarint32(1);
+        cos.WriteVarint64(static_cast<uint64_t>(-1));
+        // int32_values: 300 (unpacked elements of the same field are
+        // accepted too)
+        cos.WriteVarint32(3 << 3 | kVarint);
+        cos.WriteVarint32(300);
+        // sint64_values: LEN {-2, 3}
+        cos.WriteVarint32(6 << 3 | kLen);
+        cos.WriteVarint32(2);
+        cos.WriteSignedVarint64(-2);
+        cos.WriteSignedVarint64(3);
+        // fixed32_values: LEN {7, 8}
+        cos.WriteVarint32(7 << 3 | kLen);
+        cos.WriteVarint32(8);
+        cos.WriteFixedInt32(7);
+        cos.WriteFixedInt32(8);
+        // double_values: LEN {}
+        cos.WriteVarint32(11 << 3 | kLen);
+        cos.WriteVarint32(0);
+        // float_values: LEN {1.5}
+        cos.WriteVarint32(12 << 3 | kLen);
+        cos.WriteVarint32(4);
+        cos.WriteFixedInt32(0x3fc00000);
+    }
+    auto check = [](const RepeatedNumericTypes& dst) {
+        EXPECT_EQ(vector<int32_t>({1, -1, 300}), dst.int32_values());
+        EXPECT_EQ(vector<int64_t>({-2, 3}), dst.sint64_values());
+        EXPECT_EQ(vector<uint32_t>({7, 8}), dst.fixed32_values());
+        EXPECT_EQ(0, dst.double_values_size());
+        EXPECT_EQ(vector<float>({1.5f}), dst.float_values());
+    };
+
+    // All the decoders accept packed fields.
+    RepeatedNumericTypes generated;
+    CodedInputStream cis(
+            reinterpret_cast<const uint8_t*>(encoded.data()), encoded.size());
+    EXPECT_TRUE(DecodeMessage(cis, encoded.size(), &generated));
+    check(generated);
+
+    RepeatedNumericTypes reflected;
+    CodedInputStream cis2(
+            reinterpret_cast<const uint8_t*>(encoded.data()), encoded.size());
+    EXPECT_TRUE(DecodeMessage(
+            cis2,
+            encoded.size(),
+            &reflected,
+            reflected.GetReflection(),
+            reflected.GetDescriptor()));
+    check(reflected);
+
+    RepeatedNumericTypes table;
+    CodedInputStream cis3(
+            reinterpret_cast<const uint8_t*>(encoded.data()), encoded.size());
+    EXPECT_TRUE(
+            ParseWithTable(cis3, RepeatedNumericTypes::kParseTable, &table));
+    check(table);
+}
+
+TEST(EncodeDecodeTest, PackedEnumTest) {
+    // enum_values: LEN {REP_ENUM_B, REP_ENUM_A}
+    string encoded = "";
+    encoded += static_cast<char>(REP_ENUM_B);
+    encoded += static_cast<char>(REP_ENUM_A);
+
+    RepeatedMessage dst;
+    CodedInputStream cis(
+            reinterpret_cast<const uint8_t*>(encoded.data()), encoded.size());
+    EXPECT_TRUE(DecodeMessage(cis, encoded.size(), &dst));
+    EXPECT_EQ(vector<RepeatedEnum>({REP_ENUM_B, REP_ENUM_A}),
+              dst.enum_values());
+}
+
+TEST(EncodeDecodeTest, PackedEncodingTest) {
+    RepeatedMessage src;
+    *src.mutable_nums() = {1, -1, 300};
+    src.mutable_enum_values()->push_back(REP_ENUM_B);
+    *src.mutable_unpacked_nums() = {1, 2};
+    string encoded;
+    {
+        StringOutputStream out(&encoded);
+        CodedOutputStream cos(&out);
+        EXPECT_TRUE(src.EncodeImpl(cos));
+    }
+
+    string expected;
+    // nums: LEN 13 {1, -1, 300} (-1 is sign-extended to 10 bytes)
+    expected += "\x0a\x0d\x01";
+    expected += string(9, '\xff') + "\x01";
+    expected += "\xac\x02";
+    // enum_values: LEN 1 {REP_ENUM_B}
+    expected += "\x1a\x01\x02";
+    // unpacked_nums: 1, 2
+    expected += "\x30\x01\x30\x02";
+    EXPECT_EQ(expected, encoded);
+    EXPECT_EQ(encoded.size(), src.ComputeEncodedSize());
+
+    const Descriptor* descriptor = src.GetDescriptor();
+    EXPECT_TRUE(descriptor->FindFieldByNumber(1)->IsPacked());
+    EXPECT_FALSE(descriptor->FindFieldByNumber(2)->IsPacked());
+    EXPECT_TRUE(descriptor->FindFieldByNumber(3)->IsPacked());
+    EXPECT_FALSE(descriptor->FindFieldByNumber(6)->IsPacked());
+
+    RepeatedMessage dst;
+    CodedInputStream cis(
+            reinterpret_cast<const uint8_t*>(encoded.data()), encoded.size());
+    EXPECT_TRUE(DecodeMessage(cis, encoded.size(), &dst));
+    EXPECT_EQ(src.nums(), dst.nums());
+    EXPECT_EQ(src.enum_values(), dst.enum_values());
+    EXPECT_EQ(src.unpacked_nums(), dst.unpacked_nums());
+}
+
+TEST(EncodeDecodeTest, PackedFixedEncodingTest) {
+    RepeatedNumericTypes src;
+    *src.mutable_float_values() = {1.5f, -2.0f};
+    string encoded;
+    {
+        StringOutputStream out(&encoded);
+        CodedOutputStream cos(&out);
+        EXPECT_TRUE(src.EncodeImpl(cos));
+    }
+
+    // float_values: LEN 8 {1.5, -2.0}
+    EXPECT_EQ(string("\x62\x08\x00\x00\xc0\x3f\x00\x00\x00\xc0", 10),
+              encoded);
+    EXPECT_EQ(encoded.size(), src.ComputeEncodedSize());
+}
+
 TEST(EncodeDecodeTest, NestedMessageTest) {
     stringstream ss;
     StlInputStream iss(&ss);
@@ -397,3 +683,35 @@ TEST(EncodeDecodeTest, DefaultSubMessageTest) {
 
     EXPECT_TRUE(dst.has_other());
 }
+
+TEST(EncodeDecodeTest, DelimitedMessagesTest) {
+    string encoded;
+    StringOutputStream oss(&encoded);
+
+    for (int i = 0; i < 10; i++) {
+        RepeatedNumericTypes src;
+        src.add_uint32_values();
+        src.set_uint32_values(0, i);
+        // ZigZag-encoded values must be sized correctly as well.
+        *src.add_sint32_values() = -i;
+        *src.add_sint64_values() = -i * 1000000000000LL;
+        EXPECT_TRUE(EncodeDelimited(src, oss));
+    }
+
+    stringstream ss(encoded);
+    StlInputStream iss(&ss);
+    DelimitedReader reader(&iss);
+    RepeatedNumericTypes dst;
+    int count = 0;
+    while (reader.Next(&dst)) {
+        // dst is cleared before decoding each message.
+        EXPECT_EQ(1, dst.uint32_values_size());
+        EXPECT_EQ(count, dst.get_uint32_values(0));
+        EXPECT_EQ(1, dst.sint32_values_size());
+        EXPECT_EQ(-count, dst.get_sint32_values(0));
+        EXPECT_EQ(-count * 1000000000000LL, dst.get_sint64_values(0));
+        count++;
+    }
+    EXPECT_EQ(10, count);
+    EXPECT_FALSE(reader.HadError());
+}
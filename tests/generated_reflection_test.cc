@@ -110,6 +110,19 @@ TEST(ReflectionTest, StringNotCopiedTest) {
     EXPECT_EQ(&m.str(), &reflection->GetString(&m, kStrTag));
 }
 
+TEST(ReflectionTest, AliasedStrTest) {
+    SimpleMessage m;
+
+    const Reflection* reflection = m.GetReflection();
+
+    std::string buffer = "udon";
+    reflection->SetStringView(&m, kStrTag, buffer);
+
+    // The view getter reads the aliased bytes without copying them
+    EXPECT_EQ(buffer.data(), reflection->GetStringView(&m, kStrTag).data());
+    EXPECT_DEBUG_DEATH(reflection->GetString(&m, kStrTag), "str_view");
+}
+
 TEST(ReflectionTest, EnumTest) {
     SimpleMessage m;
 
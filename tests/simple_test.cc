@@ -28,6 +28,35 @@ TEST(SimpleTest, StrTest) {
     EXPECT_EQ("", m.str());
 }
 
+TEST(SimpleTest, StrAliasTest) {
+    SimpleMessage m;
+    EXPECT_EQ("", m.str_view());
+
+    std::string buffer = "foo bar";
+    m.set_str_alias(buffer);
+    EXPECT_EQ("foo bar", m.str_view());
+    EXPECT_EQ(buffer.data(), m.str_view().data());
+
+    // The const getter refuses to read the aliased bytes.
+    EXPECT_DEBUG_DEATH(m.str(), "str_view");
+    EXPECT_EQ(buffer.data(), m.str_view().data());
+
+    // The mutable getter does.
+    EXPECT_EQ("foo bar", *m.mutable_str());
+    EXPECT_EQ("foo bar", m.str());
+    EXPECT_NE(buffer.data(), m.str_view().data());
+
+    m.set_str_alias(buffer);
+    *m.mutable_str() += "!";
+    EXPECT_EQ("foo bar!", m.str_view());
+    EXPECT_EQ("foo bar", buffer);
+
+    m.set_str_alias(buffer);
+    m.clear_str();
+    EXPECT_EQ("", m.str_view());
+    EXPECT_EQ("", m.str());
+}
+
 TEST(SimpleTest, EnumTest) {
     SimpleMessage m;
 